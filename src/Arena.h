@@ -0,0 +1,127 @@
+#ifndef PYTHON_INTERPRETER_ARENA_H
+#define PYTHON_INTERPRETER_ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Scratch memory for the temporaries of the statement being evaluated.
+// Allocation bumps a pointer through CHUNK-byte chunks; a Guard notes the
+// top when it is made and drops everything above it when it goes away, so
+// guards nest like the statements that own them. deallocate only takes
+// back the newest block. Nothing allocated here may outlive its guard:
+// values that escape are copied into ordinary containers first.
+namespace arena {
+
+    static const size_t CHUNK = 1 << 16, ALIGN = 16;
+
+    struct Chunk {
+        Chunk *prev;
+        size_t size; // usable bytes after the header
+    };
+    static const size_t HEADER = (sizeof(Chunk) + ALIGN - 1) & ~(ALIGN - 1);
+
+    struct State {
+        Chunk *chunk; // newest chunk, or null
+        char *top, *end;
+        Chunk *spare; // an emptied CHUNK-sized chunk, kept for the next one
+        bool closed;  // the thread is exiting, stop keeping spares
+    };
+    // Plain data, so it stays usable while statics are destroyed.
+    inline State &state() {
+        static thread_local State res;
+        return res;
+    }
+
+    struct Reaper {
+        ~Reaper() {
+            State &s = state();
+            s.closed = true;
+            free(s.spare);
+            s.spare = nullptr;
+        }
+    };
+    inline void arm() {
+        static thread_local Reaper res;
+        (void) res;
+    }
+
+    inline char *data(Chunk *c) { return reinterpret_cast<char *>(c) + HEADER; }
+    inline size_t round(size_t n) { return (n + ALIGN - 1) & ~(ALIGN - 1); }
+
+    // Starts a chunk with room for n bytes.
+    inline void grow(size_t n) {
+        State &s = state();
+        Chunk *c;
+        if (n <= CHUNK && s.spare) c = s.spare, s.spare = nullptr;
+        else {
+            size_t size = n <= CHUNK ? CHUNK : n;
+            c = static_cast<Chunk *>(malloc(HEADER + size));
+            if (!c) throw std::bad_alloc();
+            c->size = size;
+            arm();
+        }
+        c->prev = s.chunk;
+        s.chunk = c;
+        s.top = data(c), s.end = s.top + c->size;
+    }
+
+    inline void *allocate(size_t n) {
+        State &s = state();
+        n = round(n);
+        if ((size_t) (s.end - s.top) < n) grow(n);
+        void *res = s.top;
+        s.top += n;
+        return res;
+    }
+    inline void deallocate(void *p, size_t n) {
+        State &s = state();
+        if (static_cast<char *>(p) + round(n) == s.top) s.top = static_cast<char *>(p);
+    }
+
+    struct Mark {
+        Chunk *chunk;
+        char *top;
+    };
+    inline Mark mark() {
+        State &s = state();
+        return {s.chunk, s.top};
+    }
+    inline void rewind(const Mark &m) {
+        State &s = state();
+        while (s.chunk != m.chunk) {
+            Chunk *c = s.chunk;
+            s.chunk = c->prev;
+            if (c->size == CHUNK && !s.spare && !s.closed) s.spare = c;
+            else free(c);
+        }
+        s.top = m.top;
+        s.end = s.chunk ? data(s.chunk) + s.chunk->size : nullptr;
+    }
+
+    class Guard {
+        Mark m;
+    public:
+        Guard() : m(mark()) {}
+        ~Guard() { rewind(m); }
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+    };
+
+    // For standard containers of temporaries.
+    template <class T>
+    struct Allocator {
+        typedef T value_type;
+        Allocator() {}
+        template <class U> Allocator(const Allocator<U> &) {}
+        T *allocate(size_t n) { return static_cast<T *>(arena::allocate(n * sizeof(T))); }
+        void deallocate(T *p, size_t n) { arena::deallocate(p, n * sizeof(T)); }
+    };
+    template <class T, class U>
+    bool operator==(const Allocator<T> &, const Allocator<U> &) { return true; }
+    template <class T, class U>
+    bool operator!=(const Allocator<T> &, const Allocator<U> &) { return false; }
+
+}
+
+#endif
@@ -1,104 +1,441 @@
 #ifndef PYTHON_INTERPRETER_BASETYPE_H
 #define PYTHON_INTERPRETER_BASETYPE_H
 
+#include <cmath>
 #include <string>
 #include <iostream>
 #include "BigInteger.h"
+#include "FloatFormat.h"
+#include "FloatParse.h"
+#include "Str.h"
+#include "Exception.h"
 using std::string;
 using std::cout;
 using std::endl;
 
+class Generator;
+
 inline int max(const int &a, const int &b) {
     return a < b ? b : a;
 }
 
+// Reference-counted payload of the values that do not fit in a BaseType.
+struct Object {
+    mutable long refs;
+    Object() : refs(1) {}
+    virtual ~Object() {}
+};
+
+struct BigObject : Object {
+    int2048 v;
+    explicit BigObject(const int2048 &_v) : v(_v) {}
+    explicit BigObject(int2048 &&_v) : v(std::move(_v)) {}
+};
+
+struct StrObject : Object {
+    Str v;
+    explicit StrObject(const Str &_v) : v(_v) {}
+};
+
+// t: 0 None, 1 bool, 2 int, 3 float, 4 str, 5 generator, < 0 control flow.
+// None, bools, floats and integers that fit in a long long are stored inline;
+// big integers, strings and generators point to a shared Object, so copying
+// a value never copies more than these 16 bytes.
 class BaseType{
 public:
-    int t;
-    bool b;
-    int2048 i;
-    double d;
-    string s;
+    short t;
+    bool big; // t == 2 and the integer is a BigObject
+    union {
+        bool b;
+        long long n;
+        double d;
+        Object *p;
+    };
+private:
+    bool heap() const { return t == 4 || t == 5 || (t == 2 && big); }
+    void retain() const { if (heap()) ++p->refs; }
+    void release() { if (heap() && !--p->refs) delete p; }
+    void setInt(const int2048 &x) {
+        big = !x.fits(n);
+        if (big) p = new BigObject(x);
+    }
+    void setInt(int2048 &&x) {
+        big = !x.fits(n);
+        if (big) p = new BigObject(std::move(x));
+    }
 public:
-    BaseType() { t = b = d = 0, s.clear(); }
-    BaseType(bool _b) { t = 1, b = _b; }
-    BaseType(int2048 _i) { t = 2, i = _i; }
-    BaseType(double _d) { t = 3, d = _d; }
-    BaseType(string _s) { t = 4, s = _s; }
-    BaseType(int err, int _t) { t = _t; }
+    // Same payload: for big integers, the same shared object. Shared
+    // objects are copied before being changed, so this implies equal values.
+    static bool same(const BaseType &lhs, const BaseType &rhs) {
+        return lhs.t == rhs.t && lhs.big == rhs.big && lhs.n == rhs.n;
+    }
+    BaseType() : t(0), big(false), n(0) {}
+    BaseType(bool _b) : t(1), big(false), n(0) { b = _b; }
+    BaseType(long long _n) : t(2), big(false), n(_n) {}
+    BaseType(const int2048 &_i) : t(2) { setInt(_i); }
+    BaseType(int2048 &&_i) : t(2) { setInt(std::move(_i)); }
+    BaseType(double _d) : t(3), big(false), d(_d) {}
+    BaseType(const Str &_s) : t(4), big(false), p(new StrObject(_s)) {}
+    BaseType(string _s) : BaseType(Str(std::move(_s))) {}
+    BaseType(Generator *_g); // takes over the reference of _g
+    BaseType(int err, int _t) : t(_t), big(false), n(0) {}
+    BaseType(const BaseType &rhs) : t(rhs.t), big(rhs.big), n(rhs.n) { retain(); }
+    BaseType(BaseType &&rhs) noexcept : t(rhs.t), big(rhs.big), n(rhs.n) { rhs.t = 0; }
+    BaseType &operator=(const BaseType &rhs) {
+        rhs.retain();
+        release();
+        t = rhs.t, big = rhs.big, n = rhs.n;
+        return *this;
+    }
+    BaseType &operator=(BaseType &&rhs) noexcept {
+        if (this != &rhs) {
+            release();
+            t = rhs.t, big = rhs.big, n = rhs.n;
+            rhs.t = 0;
+        }
+        return *this;
+    }
+    ~BaseType() { release(); }
+
     bool isBreak() { return t == -2; }
     bool isVar() { return t > 0; }
     bool isContinue() { return t == -3; }
     bool isReturn() { return t == -4; }
+    bool isSmall() const { return t == 2 && !big; }
+    bool isInt() const { return t == 1 || t == 2; }
+    // Bools and inline integers as a machine integer.
+    bool small(long long &x) const {
+        if (t == 2 && !big) return x = n, true;
+        if (t == 1) return x = b, true;
+        return false;
+    }
+
+    // The integer value, without copying big ones.
+    const int2048 &intRef(int2048 &tmp) const {
+        if (t == 2 && big) return static_cast<BigObject *>(p)->v;
+        return tmp = (int2048) *this;
+    }
+
+    const Str &text() const {
+        static const Str empty;
+        return t == 4 ? static_cast<StrObject *>(p)->v : empty;
+    }
+    Generator *gen() const;
+
+    // Mutable access to a big integer / string payload, copied first if it
+    // is shared with other values.
+    int2048 &bigint() {
+        if (p->refs > 1) --p->refs, p = new BigObject(static_cast<BigObject *>(p)->v);
+        return static_cast<BigObject *>(p)->v;
+    }
+    Str &str() {
+        if (p->refs > 1) --p->refs, p = new StrObject(static_cast<StrObject *>(p)->v);
+        return static_cast<StrObject *>(p)->v;
+    }
+    // Moves a big integer back inline once it fits again.
+    void shrink() {
+        long long x;
+        if (t == 2 && big && static_cast<BigObject *>(p)->v.fits(x)) {
+            release();
+            big = false, n = x;
+        }
+    }
+
     explicit operator bool() const {
         if (t == 1) return b;
-        if (t == 2) return (bool) i;
+        if (t == 2) return big || n;
         if (t == 3) return (bool) d;
-        if (t == 4) return !s.empty();
+        if (t == 4) return !text().empty();
+        return t == 5;
     }
     explicit operator int2048() const {
         if (t == 1) return int2048(b ? 1 : 0);
-        if (t == 2) return i;
-        if (t == 3) {
-            string res = std::to_string(d);
-            res.resize(res.size() - 7);
-            return int2048(res);
-        }
-        if (t == 4) return int2048(s);
+        if (t == 2) return big ? static_cast<BigObject *>(p)->v : int2048(n);
+        if (t == 3) return int2048::fromDouble(d);
+        if (t == 4) return int2048(text().str());
+        return int2048();
     }
     explicit operator double() const {
         if (t == 1) return b;
-        if (t == 2) return (double) i;
+        if (t == 2) return big ? (double) static_cast<BigObject *>(p)->v : (double) n;
         if (t == 3) return d;
-        if (t == 4) return stod(s);
+        if (t == 4) {
+            // like Python, surrounding whitespace is fine; anything else that
+            // is not a float literal raises ValueError
+            const string s = text().str();
+            size_t l = s.find_first_not_of(" \t\n\r\f\v"), r = s.find_last_not_of(" \t\n\r\f\v");
+            double res;
+            if (l == string::npos || !floatparse::parse(s.data() + l, s.data() + r + 1, res))
+                throw Exception("could not convert string to float: " + repr(), VALUE_ERROR);
+            return res;
+        }
+        return 0;
     }
     explicit operator string() const {
         if (t == 1) return b ? "True" : "False";
-        if (t == 2) return i.tostring();
-        if (t == 3) return std::to_string(d);
-        return s;
+        if (t == 2) return big ? static_cast<BigObject *>(p)->v.tostring() : std::to_string(n);
+        if (t == 3) {
+            char buf[floatfmt::BUF];
+            return string(buf, floatfmt::fixed(buf, d));
+        }
+        if (t == 5) return "<generator object>";
+        return text().str();
+    }
+    // Python's repr: shortest round-trip digits for floats, quoted strings.
+    string repr() const {
+        if (t == 3) {
+            char buf[floatfmt::BUF];
+            return string(buf, floatfmt::repr(buf, d));
+        }
+        if (!t) return "None";
+        if (t != 4) return (string) *this;
+        const string s = text().str();
+        char q = s.find("'") != string::npos && s.find("\"") == string::npos ? '"' : '\'';
+        string res(1, q);
+        for (char c : s) {
+            if (c == q || c == '\\') res += '\\', res += c;
+            else if (c == '\n') res += "\\n";
+            else if (c == '\t') res += "\\t";
+            else res += c;
+        }
+        return res += q;
     }
     BaseType operator-() {
-        if (t == 1) return BaseType((int2048)(-b));
-        if (t == 2) return BaseType(-i);
+        if (t == 1) return BaseType((long long) -b);
+        if (t == 2) return big || n == LLONG_MIN ? BaseType(-(int2048) *this) : BaseType(-n);
         if (t == 3) return BaseType(-d);
+        return *this;
     }
+    // Integer operators try the machine-integer path first and fall back to
+    // int2048 on overflow; BaseType(int2048) moves results back inline.
+    // Big operands are read in place through intRef instead of copied.
     friend BaseType operator+(const BaseType &lhs, const BaseType &rhs) {
+        long long x, y, r;
+        if (lhs.small(x) && rhs.small(y) && !__builtin_add_overflow(x, y, &r)) return BaseType(r);
         int t = max(lhs.t, rhs.t);
-        if (t <= 2) return BaseType((int2048) lhs + (int2048) rhs);
+        int2048 a, b;
+        if (t <= 2) return BaseType(lhs.intRef(a) + rhs.intRef(b));
         if (t == 3) return BaseType((double) lhs + (double) rhs);
-        if (t == 4) return BaseType((string) lhs + (string) rhs);
+        if (t == 4) return BaseType((lhs.t == 4 ? lhs.text() : Str((string) lhs)) + (rhs.t == 4 ? rhs.text() : Str((string) rhs)));
+        return BaseType();
     }
     friend BaseType operator-(const BaseType &lhs, const BaseType &rhs) {
+        long long x, y, r;
+        if (lhs.small(x) && rhs.small(y) && !__builtin_sub_overflow(x, y, &r)) return BaseType(r);
         int t = max(lhs.t, rhs.t);
-        if (t <= 2) return BaseType((int2048) lhs - (int2048) rhs);
+        int2048 a, b;
+        if (t <= 2) return BaseType(lhs.intRef(a) - rhs.intRef(b));
         if (t == 3) return BaseType((double) lhs - (double) rhs);
+        return BaseType();
     }
     friend BaseType mul(const BaseType &lhs, const BaseType &rhs) {
+        long long x, y, r;
+        if (lhs.small(x) && rhs.small(y) && !__builtin_mul_overflow(x, y, &r)) return BaseType(r);
         int t = max(lhs.t, rhs.t);
-        if (t <= 2) return BaseType((int2048) lhs * (int2048) rhs);
+        int2048 a, b;
+        if (t <= 2) return BaseType(lhs.intRef(a) * rhs.intRef(b));
         if (t == 3) return BaseType((double) lhs * (double) rhs);
         if (t == 4) {
-            int k = lhs.t == 4 ? (int) rhs.i : (int) lhs.i;
-            string t = lhs.t == 4 ? lhs.s : rhs.s;
+            int k = lhs.t == 4 ? (int) (int2048) rhs : (int) (int2048) lhs;
+            string t = lhs.t == 4 ? lhs.text().str() : rhs.text().str();
             string res;
             res.clear();
-            while (k) {
+            while (k > 0) {
                 if (k & 1) res = res + t;
                 t = t + t;
                 k >>= 1;
             }
             return res;
         }
+        return BaseType();
     }
     friend BaseType ddiv(const BaseType &lhs, const BaseType &rhs) {
         return BaseType((double) lhs / (double) rhs);
     }
+    // Floor quotient and remainder from one division; single-limb divisors
+    // take an O(n) loop. A zero divisor throws, like Python's
+    // ZeroDivisionError.
+    friend void divmod(const BaseType &lhs, const BaseType &rhs, BaseType &q, BaseType &r) {
+        long long x, y;
+        if (lhs.small(x) && rhs.small(y) && y && !(x == LLONG_MIN && y == -1)) {
+            long long qq = x / y, rr = x % y;
+            if (rr && (rr < 0) != (y < 0)) --qq, rr += y;
+            q = BaseType(qq), r = BaseType(rr);
+            return;
+        }
+        int2048 tmp;
+        if (rhs.small(y)) {
+            if (y == 0) throw Exception("integer division or modulo by zero", ZERO_DIVISION);
+            int2048 v = lhs.intRef(tmp);
+            long long rr = v.divmodSmall(y);
+            q = BaseType(v), r = BaseType(rr);
+            return;
+        }
+        int2048 tmp2, iq, ir;
+        const int2048 &d = rhs.intRef(tmp2);
+        if (!d.bitLength()) throw Exception("integer division or modulo by zero", ZERO_DIVISION);
+        divmod(lhs.intRef(tmp), d, iq, ir);
+        q = BaseType(iq), r = BaseType(ir);
+    }
     friend BaseType idiv(const BaseType &lhs, const BaseType &rhs) {
-        return BaseType((int2048) lhs / (int2048) rhs);
+        BaseType q, r;
+        divmod(lhs, rhs, q, r);
+        return q;
     }
     friend BaseType mod(const BaseType &lhs, const BaseType &rhs) {
-        return BaseType((int2048) lhs % (int2048) rhs);
+        long long x, y;
+        if (lhs.small(x) && rhs.small(y) && y) {
+            long long r = y == -1 ? 0 : x % y;
+            if (r && (r < 0) != (y < 0)) r += y;
+            return BaseType(r);
+        }
+        int2048 tmp;
+        if (rhs.small(y) && y != 0) return BaseType(lhs.intRef(tmp).modSmall(y));
+        BaseType q, r;
+        divmod(lhs, rhs, q, r);
+        return r;
+    }
+    // Python's ** on numbers: exact for integer exponents >= 0 (squared
+    // in machine integers until they overflow), a float otherwise.
+    friend BaseType power(const BaseType &lhs, const BaseType &rhs) {
+        int t = max(lhs.t, rhs.t);
+        if (t == 3) return BaseType(std::pow((double) lhs, (double) rhs));
+        if (t != 2 && t != 1) return BaseType();
+        long long x, e;
+        int2048 tmp;
+        if (!rhs.small(e)) {
+            // a huge exponent only has a result for bases 0, 1 and -1
+            const int2048 &k = rhs.intRef(tmp);
+            if (k < int2048(0)) return BaseType(std::pow((double) lhs, (double) k));
+            if (!lhs.small(x) || x < -1 || x > 1) return BaseType();
+            return BaseType(x == -1 && !k.modSmall(2) ? 1ll : x);
+        }
+        if (e < 0) return BaseType(std::pow((double) lhs, (double) e));
+        if (lhs.small(x)) {
+            long long res = 1;
+            bool ok = true;
+            for (unsigned long long k = e; ok; k >>= 1) {
+                if (k & 1) ok = !__builtin_mul_overflow(res, x, &res);
+                if (k < 2) break;
+                ok = ok && !__builtin_mul_overflow(x, x, &x);
+            }
+            if (ok) return BaseType(res);
+        }
+        return BaseType(int2048::pow(lhs.intRef(tmp), e));
+    }
+    // pow(base, e, m) on integers with m != 0; a negative e raises the
+    // inverse of base, if any. None otherwise.
+    friend BaseType powmod(const BaseType &base, const BaseType &e, const BaseType &m) {
+        int2048 a, b, c, inv;
+        for (const BaseType *v : {&base, &e, &m})
+            if (!v->isInt()) return BaseType();
+        const int2048 &k = e.intRef(b), &mod = m.intRef(c);
+        if (!(bool) mod) return BaseType();
+        if (k < int2048(0)) {
+            if (!int2048::modinv(base.intRef(a), mod, inv)) return BaseType();
+            return BaseType(int2048::powmod(inv, -k, mod));
+        }
+        return BaseType(int2048::powmod(base.intRef(a), k, mod));
+    }
+    // (lhs * rhs) % m, (lhs + rhs) % m or (lhs - rhs) % m for op 1, 2, 3.
+    // With machine integers throughout, the remainder is taken straight
+    // from the 128-bit product or sum, without a big intermediate.
+    friend BaseType fusedMod(const BaseType &lhs, const BaseType &rhs, int op, const BaseType &m) {
+        long long x, y, z;
+        if (lhs.small(x) && rhs.small(y) && m.small(z) && z) {
+            __int128 v = op == 1 ? (__int128) x * y : op == 2 ? (__int128) x + y : (__int128) x - y;
+            unsigned long long um = int2048::magnitude(z);
+            unsigned long long r = (unsigned long long) ((v < 0 ? -(unsigned __int128) v : (unsigned __int128) v) % um);
+            if (r && (v < 0) != (z < 0)) r = um - r;
+            return BaseType(z < 0 ? -(long long) r : (long long) r);
+        }
+        return mod(op == 1 ? mul(lhs, rhs) : op == 2 ? lhs + rhs : lhs - rhs, m);
+    }
+    // Bitwise operators on integers (None for other types); op is '&', '|'
+    // or '^'. Machine integers already have Python's two's complement
+    // semantics, and bools combine into a bool.
+    friend BaseType bitwise(const BaseType &lhs, const BaseType &rhs, char op) {
+        long long x, y;
+        if (lhs.small(x) && rhs.small(y)) {
+            long long r = op == '&' ? x & y : op == '|' ? x | y : x ^ y;
+            return lhs.t == 1 && rhs.t == 1 ? BaseType((bool) r) : BaseType(r);
+        }
+        if (max(lhs.t, rhs.t) != 2 || !lhs.t || !rhs.t) return BaseType();
+        int2048 a, b;
+        const int2048 &u = lhs.intRef(a), &v = rhs.intRef(b);
+        return BaseType(op == '&' ? u & v : op == '|' ? u | v : u ^ v);
+    }
+    friend BaseType invert(const BaseType &x) {
+        long long v;
+        if (x.small(v)) return BaseType(~v);
+        int2048 a;
+        return x.t == 2 ? BaseType(~x.intRef(a)) : BaseType();
+    }
+    // lhs << rhs (left) or lhs >> rhs. Negative counts raise ValueError and
+    // left shifts of nonzero values by counts beyond a long long raise
+    // OverflowError, as in Python. Shifts that stay within a long long skip
+    // int2048.
+    friend BaseType shift(const BaseType &lhs, const BaseType &rhs, bool left) {
+        if (!lhs.isInt() || !rhs.isInt()) return BaseType();
+        long long x, k;
+        int2048 a;
+        if (!rhs.small(k)) {
+            if (rhs.intRef(a) < int2048(0)) throw Exception("negative shift count", VALUE_ERROR);
+            if (left && (bool) lhs) throw Exception("too many digits in integer", OVERFLOW_ERROR);
+            return BaseType(!left && lhs < BaseType(0ll) ? -1ll : 0ll);
+        }
+        if (k < 0) throw Exception("negative shift count", VALUE_ERROR);
+        if (lhs.small(x)) {
+            if (!left) return BaseType(k >= 64 ? (x < 0 ? -1ll : 0ll) : x >> k);
+            if (!x) return BaseType(0ll);
+            if (k < 64 && __builtin_clrsbll(x) >= k) return BaseType((long long) ((unsigned long long) x << k));
+        }
+        const int2048 &u = lhs.intRef(a);
+        return BaseType(left ? int2048::shiftLeft(u, k) : int2048::shiftRight(u, k));
+    }
+    // Number theory on integers, None for other types: the non-negative
+    // gcd, floor(sqrt(x)) for x >= 0, a^-1 mod m with the sign of m (None
+    // when gcd(a, m) != 1), and a Miller-Rabin test. Machine integers take
+    // the word-sized paths.
+    friend BaseType gcd(const BaseType &lhs, const BaseType &rhs) {
+        if (!lhs.isInt() || !rhs.isInt()) return BaseType();
+        long long x, y;
+        if (lhs.small(x) && rhs.small(y)) {
+            unsigned long long g = int2048::gcdLimb(int2048::magnitude(x), int2048::magnitude(y));
+            if (g <= LLONG_MAX) return BaseType((long long) g);
+        }
+        int2048 a, b;
+        return BaseType(int2048::gcd(lhs.intRef(a), rhs.intRef(b)));
+    }
+    friend BaseType isqrt(const BaseType &x) {
+        if (!x.isInt() || x < BaseType(0ll)) return BaseType();
+        long long v;
+        if (x.small(v)) {
+            long long r = (long long) std::sqrt((double) v);
+            while ((__int128) r * r > v) --r;
+            while ((__int128) (r + 1) * (r + 1) <= v) ++r;
+            return BaseType(r);
+        }
+        int2048 a;
+        return BaseType(int2048::isqrt(x.intRef(a)));
+    }
+    friend BaseType modinv(const BaseType &a, const BaseType &m) {
+        if (!a.isInt() || !m.isInt()) return BaseType();
+        long long x, z;
+        if (a.small(x) && m.small(z) && z) {
+            unsigned long long um = int2048::magnitude(z), ux = int2048::magnitude(x) % um, r;
+            if (x < 0 && ux) ux = um - ux;
+            if (!int2048::modinvLimb(ux, um, r)) return BaseType();
+            return BaseType(z < 0 && r ? (long long) r + z : (long long) r);
+        }
+        int2048 u, v, res;
+        if (!int2048::modinv(a.intRef(u), m.intRef(v), res)) return BaseType();
+        return BaseType(res);
+    }
+    friend BaseType isProbablePrime(const BaseType &n, int rounds) {
+        if (!n.isInt()) return BaseType();
+        int2048 a;
+        return BaseType(int2048::isProbablePrime(n.intRef(a), rounds));
     }
     friend bool operator<(const BaseType &lhs, const BaseType &rhs) {
         const int &t = max(lhs.t, rhs.t);
@@ -106,9 +443,13 @@ public:
         if (lhs.t && !rhs.t) return true;
         if (!lhs.t && !rhs.t) return false;
         if (t == 1) return lhs.b < rhs.b;
-        if (t == 2) return (int2048) lhs < (int2048) rhs;
+        long long x, y;
+        if (lhs.small(x) && rhs.small(y)) return x < y;
+        int2048 a, b;
+        if (t == 2) return lhs.intRef(a) < rhs.intRef(b);
         if (t == 3) return (double) lhs < (double) rhs;
-        if (t == 4) return lhs.s < rhs.s;
+        if (t == 4) return lhs.text() < rhs.text();
+        return lhs.p < rhs.p;
     }
     friend bool operator>(const BaseType &lhs, const BaseType &rhs) { return rhs < lhs; }
     friend bool operator<=(const BaseType &lhs, const BaseType &rhs) { return !(rhs < lhs); }
@@ -119,11 +460,20 @@ public:
         if (t < 0) std::cout << " ERR ! " << t;
         if (t == 0) printf("None");
         if (t == 1) printf(b ? "True" : "False");
-        if (t == 2) std::cout << i;
-        if (t == 3) printf("%.6lf", d);
-        if (t == 4) std::cout << s;
+        if (t == 2) {
+            if (big) std::cout << static_cast<BigObject *>(p)->v;
+            else printf("%lld", n);
+        }
+        if (t == 3) {
+            char buf[floatfmt::BUF];
+            fwrite(buf, 1, floatfmt::fixed(buf, d), stdout);
+        }
+        if (t == 4) std::cout << text();
+        if (t == 5) printf("<generator object>");
         if (ch) putchar(ch);
     }
 };
 
+static_assert(sizeof(BaseType) == 16, "BaseType should stay a 16-byte tagged value");
+
 #endif
\ No newline at end of file
@@ -5,68 +5,84 @@
 #include <cstring>
 #include <cstdio>
 #include <vector>
+#include <deque>
 #include <algorithm>
-#include <complex>
-
-#define base 1000000000
+#include <climits>
+#include <cmath>
+#include "LimbKernels.h"
+#include "LimbVector.h"
+#include "NTT.h"
 
+// Magnitude in base 2^64, least significant limb first, without leading
+// zero limbs; opt is the sign. Limb products and carries go through
+// unsigned __int128. Decimal text is converted by divide and conquer over
+// cached powers 10^(19 * 2^j), so parsing and printing cost a few
+// multiplications rather than a quadratic number of limb operations.
+// Up to four limbs live inside the object (LimbVector), and operators
+// taking an rvalue reuse its limbs, so temporaries rarely allocate.
 class int2048 {
 
+public:
+    typedef unsigned long long limb;
+    typedef unsigned __int128 wide;
+    typedef LimbVector limbs;
+
 private:
     bool opt;
-    std::vector<long long> d;
+    limbs d;
+
+    static const limb TEN19 = 10000000000000000000ull;
 
 public:
     int2048() { opt = 0; d.clear(); }
     int2048(long long x) {
-        if (x < 0) x = -x, opt = 1;
-        else opt = 0;
-        while (x) {
-            d.push_back(x % base);
-            x /= base;
-        }
+        opt = x < 0;
+        limb u = magnitude(x);
+        if (u) d.push_back(u);
     }
     int2048(const std::string &s) {
-        opt = (s[0] == '-');
-        d.clear();
-        long long k = 1;
-        for (int i = s.size() - 1, j = 0; i >= opt; --i, j = (j + 1) % 9, k *= 10) {
-            if (!j) d.push_back(0), k = 1;
-            d.back() += k * (s[i] - '0');
-        }
-        while (!d.empty() && !d.back()) d.pop_back();
-        if (d.empty()) opt = 0;
-    }
-    int2048(const int2048 &rhs) {
-        *this = rhs;
+        size_t neg = !s.empty() && s[0] == '-';
+        *this = fromDecimal(s.data() + neg, s.size() - neg);
+        opt = neg && !d.empty();
     }
-    const int2048 operator-() const {
+    int2048(const int2048 &rhs) = default;
+    int2048(int2048 &&rhs) = default;
+    int2048 &operator=(const int2048 &rhs) = default;
+    int2048 &operator=(int2048 &&rhs) = default;
+    int2048 operator-() const & {
         int2048 tmp = *this;
         if (!tmp.d.empty()) tmp.opt ^= 1;
         return tmp;
     }
+    int2048 operator-() && {
+        if (!d.empty()) opt ^= 1;
+        return std::move(*this);
+    }
     inline friend bool operator==(const int2048 &lhs, const int2048 &rhs) {
-        if (lhs.d.size() != rhs.d.size() || lhs.opt != rhs.opt)
-            return false;
-        for (int i = 0, sz = lhs.d.size(); i < sz; ++i)
-            if (lhs.d[i] != rhs.d[i]) return false;
-        return true;
+        return lhs.opt == rhs.opt && lhs.d == rhs.d;
     }
     inline friend bool operator!=(const int2048 &lhs, const int2048 &rhs) { return !(lhs == rhs); }
     inline friend bool operator<(const int2048 &lhs, const int2048 &rhs) {
         if (lhs.opt ^ rhs.opt)
             return lhs.opt > rhs.opt;
-        if (lhs.d.size() != rhs.d.size()) 
-            return (lhs.d.size() < rhs.d.size()) ^ lhs.opt;
-        for (int i = lhs.d.size() - 1; i >= 0; --i)
-            if (lhs.d[i] != rhs.d[i])
-                return (lhs.d[i] < rhs.d[i]) ^ lhs.opt;
-        return false;
+        int c = cmpAbs(lhs, rhs);
+        return c && ((c < 0) ^ lhs.opt);
     }
     inline friend bool operator>(const int2048 &lhs, const int2048 &rhs) { return rhs < lhs; }
     inline friend bool operator<=(const int2048 &lhs, const int2048 &rhs) { return !(rhs < lhs); }
     inline friend bool operator>=(const int2048 &lhs, const int2048 &rhs) { return !(lhs < rhs); }
 
+    static limb magnitude(long long x) { return x < 0 ? 0ull - (limb) x : (limb) x; }
+
+    // Stores the value in x if it fits in a long long.
+    bool fits(long long &x) const {
+        if (d.size() > 1) return false;
+        limb v = d.empty() ? 0 : d[0];
+        if (v > (limb) LLONG_MAX + opt) return false;
+        x = opt ? (long long) (0ull - v) : (long long) v;
+        return true;
+    }
+
     void read(const std::string &s) {
         *this = int2048(s);
     }
@@ -74,12 +90,7 @@ public:
         if (d.empty()) return "0";
         std::string res;
         if (opt) res = "-";
-        for (int i = d.size() - 1; i >= 0; --i) {
-            char tmp[12];
-            sprintf(tmp, i == d.size() - 1 ? "%lld" : "%09lld", d[i]);
-            for (char *p = tmp; *p; ++p)
-                res += *p;
-        }
+        toDecimal(*this, res, 0);
         return res;
     }
     void print(char ch = 0) const {
@@ -87,180 +98,957 @@ public:
         if (ch) putchar(ch);
     }
 
-    static int2048 add(int2048 lhs, const int2048 &rhs) {
-        if (lhs.opt ^ rhs.opt)
-            return !lhs.opt ? minus(lhs, -rhs) : minus(rhs, -lhs);
-        int len = std::max(lhs.d.size(), rhs.d.size()) + 1;
-        lhs.d.resize(len);
-        for (int i = 0; i < len - 1; ++i) {
-            lhs.d[i] += (i < rhs.d.size() ? rhs.d[i] : 0);
-            if (lhs.d[i] >= base) {
-                lhs.d[i + 1] += lhs.d[i] / base;
-                lhs.d[i] %= base;
+    // Decimal conversion. Below DECIMAL limbs (or 19 * DECIMAL digits)
+    // the quadratic loops win; above, the number is split at a cached
+    // power of ten of about half its size.
+    static const int DECIMAL = 32;
+
+    static const int2048 &pow10(int j) {
+        static std::deque<int2048> table; // deque: references stay valid
+        while ((int) table.size() <= j)
+            table.push_back(table.empty() ? fromLimbs(limbs(1, TEN19)) : table.back() * table.back());
+        return table[j];
+    }
+    // d = d * m + a
+    void mulAddSmall(limb m, limb a) {
+        limb carry = a;
+        for (auto &x : d) {
+            wide t = (wide) x * m + carry;
+            x = (limb) t;
+            carry = (limb) (t >> 64);
+        }
+        if (carry) d.push_back(carry);
+    }
+    static int2048 fromDecimal(const char *s, size_t n) {
+        if (n <= 19 * (size_t) DECIMAL) {
+            int2048 res;
+            for (size_t i = 0, len = (n - 1) % 19 + 1; i < n; i += len, len = 19) {
+                limb chunk = 0, scale = 1;
+                for (size_t k = i; k < i + len; ++k) chunk = chunk * 10 + (s[k] - '0'), scale *= 10;
+                res.mulAddSmall(scale, chunk);
+            }
+            return res;
+        }
+        int j = 0;
+        while ((size_t) 19 << (j + 1) < n) ++j;
+        size_t k = (size_t) 19 << j;
+        int2048 res = fromDecimal(s, n - k) * pow10(j);
+        res += fromDecimal(s + n - k, k);
+        return res;
+    }
+    // Appends the digits of |x|, left-padded with zeros to width.
+    static void toDecimal(const int2048 &x, std::string &out, size_t width) {
+        if ((int) x.d.size() <= DECIMAL) {
+            int2048 t = x;
+            limbs chunk;
+            while (!t.d.empty()) chunk.push_back(t.divSmall(TEN19));
+            std::string digits;
+            char tmp[24];
+            for (int i = (int) chunk.size() - 1; i >= 0; --i) {
+                sprintf(tmp, i == (int) chunk.size() - 1 ? "%llu" : "%019llu", chunk[i]);
+                digits += tmp;
             }
+            if (digits.size() < width) out.append(width - digits.size(), '0');
+            out += digits;
+            return;
+        }
+        int j = 0;
+        while (pow10(j + 1).d.size() * 2 <= x.d.size()) ++j;
+        size_t k = (size_t) 19 << j;
+        int2048 hi, lo;
+        divAbs(x.d, pow10(j).d, hi.d, lo.d);
+        toDecimal(hi, out, width > k ? width - k : 0);
+        toDecimal(lo, out, k);
+    }
+
+    static int cmpAbs(const limbs &lhs, const limbs &rhs) {
+        if (lhs.size() != rhs.size())
+            return lhs.size() < rhs.size() ? -1 : 1;
+        for (int i = lhs.size() - 1; i >= 0; --i)
+            if (lhs[i] != rhs[i])
+                return lhs[i] < rhs[i] ? -1 : 1;
+        return 0;
+    }
+    static int cmpAbs(const int2048 &lhs, const int2048 &rhs) { return cmpAbs(lhs.d, rhs.d); }
+
+    // *this += (neg ? -|rhs| : |rhs|), reusing the limbs of *this.
+    // rhs may alias *this.
+    int2048 &addSigned(const int2048 &rhs, bool neg) {
+        size_t n = rhs.d.size();
+        if (opt == neg) {
+            if (d.size() < n) d.resize(n);
+            limb carry = limbk::add(d.data(), d.data(), rhs.d.data(), n);
+            for (size_t i = n; carry && i < d.size(); ++i) carry = !++d[i];
+            if (carry) d.push_back(1);
+            return *this;
+        }
+        int c = cmpAbs(*this, rhs);
+        if (!c) {
+            d.clear();
+            opt = 0;
+            return *this;
         }
-        while (!lhs.d.empty() && !lhs.d.back()) lhs.d.pop_back();
+        if (c > 0) {
+            limb borrow = limbk::sub(d.data(), d.data(), rhs.d.data(), n);
+            for (size_t i = n; borrow; ++i) borrow = !d[i]--;
+        } else {
+            d.resize(n);
+            limbk::sub(d.data(), rhs.d.data(), d.data(), n);
+            opt = neg;
+        }
+        trim(d);
+        return *this;
+    }
+
+    static int2048 add(int2048 lhs, const int2048 &rhs) {
+        lhs.add(rhs);
         return lhs;
     }
     int2048 &add(const int2048 &rhs) {
-        *this = add(*this, rhs);
-        return *this;
+        return addSigned(rhs, rhs.opt);
     }
 
-    static int2048 minus(int2048 lhs, int2048 rhs) {
-        if (lhs.opt ^ rhs.opt) 
-            return add(lhs, -rhs);
-        const int &opt = (lhs < rhs);
-        if (opt ^ rhs.opt) 
-            std::swap(lhs, rhs);
-        lhs.opt = opt;
-        for (int i = 0; i < lhs.d.size(); ++i) {
-            lhs.d[i] -= (i < rhs.d.size() ? rhs.d[i] : 0);
-            while (lhs.d[i] < 0)
-                lhs.d[i] += base, lhs.d[i + 1]--;
-        }
-        while (!lhs.d.empty() && !lhs.d.back())
-            lhs.d.pop_back();
+    static int2048 minus(int2048 lhs, const int2048 &rhs) {
+        lhs.minus(rhs);
         return lhs;
     }
     int2048 &minus(const int2048 &rhs) {
-        *this = minus(*this, rhs);
-        return *this;
+        return addSigned(rhs, !rhs.opt);
     }
 
     int2048 &operator+=(const int2048 & rhs) { add(rhs); return *this; }
     friend int2048 operator+(const int2048 &lhs, const int2048 &rhs) { return add(lhs, rhs); }
+    friend int2048 operator+(int2048 &&lhs, const int2048 &rhs) { lhs.add(rhs); return std::move(lhs); }
 
     int2048 &operator-=(const int2048 & rhs) { minus(rhs); return *this; }
     friend int2048 operator-(const int2048 &lhs, const int2048 &rhs) { return minus(lhs, rhs); }
+    friend int2048 operator-(int2048 &&lhs, const int2048 &rhs) { lhs.minus(rhs); return std::move(lhs); }
 
-    friend int2048 operator*(const int2048 &lhs, const int2048 &rhs) {
+    // Multiplication ladder on magnitudes: the basecase below KARATSUBA limbs,
+    // Karatsuba below TOOM3, Toom-3 below NTT and the three-prime NTT above;
+    // squares take cheaper variants of each step.
+    static const int KARATSUBA = 48, TOOM3 = 192, NTT = 8192;
+
+    static void trim(limbs &x) {
+        while (!x.empty() && !x.back()) x.pop_back();
+    }
+    static limbs slice(const limbs &x, size_t l, size_t r) {
+        l = std::min(l, x.size()), r = std::min(r, x.size());
+        limbs res(x.begin() + l, x.begin() + r);
+        trim(res);
+        return res;
+    }
+    static int2048 fromLimbs(limbs x) {
         int2048 res;
-        res.opt = lhs.opt ^ rhs.opt;
-        res.d.resize(lhs.d.size() + rhs.d.size());
-        for (int i = 0, szi = lhs.d.size(); i < szi; ++i)
-            for (int j = 0, szj = rhs.d.size(); j < szj; ++j) {
-                res.d[i + j] += lhs.d[i] * rhs.d[j];
-                if (res.d[i + j] >= base) {
-                    res.d[i + j + 1] += res.d[i + j] / base;
-                    res.d[i + j] %= base;
-                }
-            }
-        while (!res.d.empty() && !res.d.back())
-            res.d.pop_back();
+        res.d = std::move(x);
+        trim(res.d);
         return res;
     }
-
-    friend int2048 operator*(const int2048 &lhs, long long rhs) {
-        if (rhs >= base || rhs <= -base) {
-            int2048 tmp(rhs);
-            return tmp * lhs;
+    // x += y * 2^(64k)
+    static void addShifted(limbs &x, const limbs &y, int k) {
+        if (x.size() < y.size() + k) x.resize(y.size() + k);
+        limb carry = limbk::add(x.data() + k, x.data() + k, y.data(), y.size());
+        for (size_t i = y.size() + k; carry; ++i) {
+            if (i == x.size()) x.push_back(0);
+            carry = !++x[i];
         }
+    }
+    // x -= y, where x >= y and y is trimmed
+    static void subAbs(limbs &x, const limbs &y) {
+        limb borrow = limbk::sub(x.data(), x.data(), y.data(), y.size());
+        for (size_t i = y.size(); borrow; ++i) borrow = !x[i]--;
+        trim(x);
+    }
 
-        int2048 res;
-        res.opt = lhs.opt ^ (rhs < 0);
-        if (rhs < 0) rhs = -rhs;
-
-        res.d.resize(lhs.d.size() + 1);
-        for (int i = res.d.size() - 1; i >= 0; --i)
-            res.d[i] = 0;
-        for (int i = 0, szi = lhs.d.size(); i < szi; ++i) {
-            res.d[i] += lhs.d[i] * rhs;
-            if (res.d[i] >= base) {
-                res.d[i + 1] += res.d[i] / base;
-                res.d[i] %= base;
+    // r[0, n + m) = a[0, n) * b[0, m). Each column is summed in a 192-bit
+    // accumulator (128 bits plus a count of overflows) and carried once,
+    // instead of normalising after every limb product.
+    static void mulComba(const limb *a, int n, const limb *b, int m, limb *r) {
+        wide acc = 0;
+        limb top = 0;
+        for (int k = 0; k < n + m - 1; ++k) {
+            for (int i = std::max(0, k - m + 1), hi = std::min(k, n - 1); i <= hi; ++i) {
+                wide p = (wide) a[i] * b[k - i];
+                acc += p;
+                top += acc < p;
             }
+            r[k] = (limb) acc;
+            acc = (acc >> 64) | ((wide) top << 64);
+            top = 0;
         }
+        r[n + m - 1] = (limb) acc;
+    }
+    static void sqrComba(const limb *a, int n, limb *r) {
+        wide acc = 0;
+        limb top = 0;
+        for (int k = 0; k < 2 * n - 1; ++k) {
+            wide cross = 0;
+            limb ctop = 0;
+            for (int i = std::max(0, k - n + 1); i < k - i; ++i) {
+                wide p = (wide) a[i] * a[k - i];
+                cross += p;
+                ctop += cross < p;
+            }
+            ctop = (ctop << 1) | (limb) (cross >> 127);
+            cross <<= 1;
+            if (!(k & 1)) {
+                wide p = (wide) a[k >> 1] * a[k >> 1];
+                cross += p;
+                ctop += cross < p;
+            }
+            acc += cross;
+            top += ctop + (acc < cross);
+            r[k] = (limb) acc;
+            acc = (acc >> 64) | ((wide) top << 64);
+            top = 0;
+        }
+        r[2 * n - 1] = (limb) acc;
+    }
 
-        while (!res.d.empty() && !res.d.back()) res.d.pop_back(); 
+    // Where the CPU has mulx / adx, products from ROWS limbs up go row by
+    // row through limbk::addMul, and squares sum each cross product once,
+    // double them and add the diagonal. n >= m.
+    static const int ROWS = 8, SQR_ROWS = 12;
+    static void mulBasecase(const limb *a, int n, const limb *b, int m, limb *r) {
+        if (m < ROWS || !limbk::fastAddMul()) return mulComba(a, n, b, m, r);
+        memset(r, 0, n * sizeof(limb));
+        for (int j = 0; j < m; ++j) r[n + j] = limbk::addMul(r + j, a, n, b[j]);
+    }
+    static void sqrBasecase(const limb *a, int n, limb *r) {
+        if (n < SQR_ROWS || !limbk::fastAddMul()) return sqrComba(a, n, r);
+        memset(r, 0, 2 * n * sizeof(limb));
+        for (int i = 0; i + 1 < n; ++i) r[n + i] = limbk::addMul(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+        limb top = 0;
+        for (int i = 0; i < 2 * n; ++i) {
+            limb x = r[i];
+            r[i] = x << 1 | top;
+            top = x >> 63;
+        }
+        limb carry = 0;
+        for (int i = 0; i < n; ++i) {
+            wide p = (wide) a[i] * a[i], s = (wide) r[2 * i] + (limb) p + carry;
+            r[2 * i] = (limb) s;
+            s = (wide) r[2 * i + 1] + (limb) (p >> 64) + (limb) (s >> 64);
+            r[2 * i + 1] = (limb) s;
+            carry = (limb) (s >> 64);
+        }
+    }
 
+    static limbs karatsuba(const limbs &a, const limbs &b, bool square) {
+        int h = (a.size() + 1) / 2;
+        auto a0 = slice(a, 0, h), a1 = slice(a, h, a.size());
+        limbs z0, z1, z2;
+        if (square) {
+            z0 = mulAbs(a0, a0), z2 = mulAbs(a1, a1);
+            addShifted(a0, a1, 0);
+            z1 = mulAbs(a0, a0);
+        } else {
+            auto b0 = slice(b, 0, h), b1 = slice(b, h, b.size());
+            z0 = mulAbs(a0, b0), z2 = mulAbs(a1, b1);
+            addShifted(a0, a1, 0), addShifted(b0, b1, 0);
+            z1 = mulAbs(a0, b0);
+        }
+        subAbs(z1, z0), subAbs(z1, z2);
+        addShifted(z0, z1, h), addShifted(z0, z2, 2 * h);
+        return z0;
+    }
+
+    // Toom-3 with evaluation points 0, 1, -1, -2, inf and Bodrato's
+    // interpolation sequence. The intermediate values can be negative, so
+    // they are kept as int2048.
+    static void toomEvaluate(const limbs &x, int k, int2048 *p) {
+        int2048 x0 = fromLimbs(slice(x, 0, k)), x1 = fromLimbs(slice(x, k, 2 * k));
+        int2048 x2 = fromLimbs(slice(x, 2 * k, x.size()));
+        int2048 t = x0 + x2;
+        p[0] = x0, p[1] = t + x1, p[2] = t - x1;
+        t = p[2] + x2;
+        p[3] = t + t - x0, p[4] = x2;
+    }
+    static limbs toom3(const limbs &a, const limbs &b, bool square) {
+        int k = (a.size() + 2) / 3;
+        int2048 pa[5], pb[5], r[5];
+        toomEvaluate(a, k, pa);
+        if (!square) toomEvaluate(b, k, pb);
+        for (int i = 0; i < 5; ++i)
+            r[i] = square ? pa[i] * pa[i] : pa[i] * pb[i];
+        int2048 r3 = r[3] - r[1];
+        r3.divSmall(3);
+        int2048 r1 = r[1] - r[2];
+        r1.divSmall(2);
+        int2048 r2 = r[2] - r[0];
+        r3 = r2 - r3;
+        r3.divSmall(2);
+        r3 += r[4] + r[4];
+        r2 += r1 - r[4];
+        r1 -= r3;
+        limbs res = r[0].d;
+        addShifted(res, r1.d, k), addShifted(res, r2.d, 2 * k);
+        addShifted(res, r3.d, 3 * k), addShifted(res, r[4].d, 4 * k);
+        return res;
+    }
+
+    // The NTT works on 32-bit halves of the limbs, so that its exactness
+    // bound holds up to its maximum length.
+    static std::vector<long long> halves(const limbs &x) {
+        std::vector<long long> res(2 * x.size());
+        for (size_t i = 0; i < x.size(); ++i)
+            res[2 * i] = (long long) (x[i] & 0xffffffffu), res[2 * i + 1] = (long long) (x[i] >> 32);
         return res;
     }
 
+    static limbs mulAbs(const limbs &a, const limbs &b) {
+        int n = a.size(), m = b.size();
+        if (n < m) return mulAbs(b, a);
+        limbs res;
+        if (!m) return res;
+        bool square = &a == &b || (n == m && a == b);
+        if (m < KARATSUBA) {
+            res.resize(n + m);
+            if (square) sqrBasecase(a.data(), n, res.data());
+            else mulBasecase(a.data(), n, b.data(), m, res.data());
+        } else if (m >= NTT && 2 * (n + m) - 1 <= (int) ntt::MAX_LEN) {
+            std::vector<long long> x = halves(a), y = square ? std::vector<long long>() : halves(b);
+            std::vector<long long> z(2 * (n + m));
+            if (square) ntt::multiply(x.data(), x.size(), x.data(), x.size(), z.data(), 1ll << 32, true);
+            else ntt::multiply(x.data(), x.size(), y.data(), y.size(), z.data(), 1ll << 32);
+            res.resize(n + m);
+            for (int i = 0; i < n + m; ++i) res[i] = (limb) z[2 * i] | (limb) z[2 * i + 1] << 32;
+        } else if (2 * m <= n) {
+            // unbalanced: multiply m-limb chunks of a
+            for (int i = 0; i < n; i += m)
+                addShifted(res, mulAbs(slice(a, i, i + m), b), i);
+        } else if (m < TOOM3) res = karatsuba(a, b, square);
+        else res = toom3(a, b, square);
+        trim(res);
+        return res;
+    }
+
+    friend int2048 operator*(const int2048 &lhs, const int2048 &rhs) {
+        int2048 res;
+        res.d = mulAbs(lhs.d, rhs.d);
+        res.opt = !res.d.empty() && (lhs.opt ^ rhs.opt);
+        return res;
+    }
+
+    friend int2048 operator*(const int2048 &lhs, long long rhs) {
+        int2048 res = lhs;
+        res.mulAddSmall(magnitude(rhs), 0);
+        trim(res.d);
+        res.opt = !res.d.empty() && (lhs.opt ^ (rhs < 0));
+        return res;
+    }
+
+    // Small products go through a stack buffer and land in the existing
+    // limbs, so a loop of x *= y only allocates when x outgrows them.
     int2048 &operator*=(const int2048 &rhs) {
-        *this = *this * rhs;
+        int n = d.size(), m = rhs.d.size();
+        if (!n || !m || std::min(n, m) >= KARATSUBA || n + m > 2 * KARATSUBA) return *this = *this * rhs;
+        limb tmp[2 * KARATSUBA];
+        if (this == &rhs) sqrBasecase(d.data(), n, tmp);
+        else if (n >= m) mulBasecase(d.data(), n, rhs.d.data(), m, tmp);
+        else mulBasecase(rhs.d.data(), m, d.data(), n, tmp);
+        d.resize(n + m);
+        memcpy(d.data(), tmp, (n + m) * sizeof(limb));
+        trim(d);
+        opt = !d.empty() && (opt ^ rhs.opt);
         return *this;
     }
 
-    void shift(int x) {
-        d.resize(d.size() + 1);
-        for (int i = d.size() - 1; i; --i)
-            d[i] = d[i - 1];
-        d[0] = x;
+    // Divides the magnitude by 0 < v in place and returns the remainder of
+    // the magnitude.
+    limb divSmall(limb v) {
+        limb rem = 0;
+        for (int i = d.size() - 1; i >= 0; --i) {
+            wide cur = (wide) rem << 64 | d[i];
+            d[i] = (limb) (cur / v);
+            rem = (limb) (cur % v);
+        }
+        trim(d);
+        if (d.empty()) opt = 0;
+        return rem;
+    }
+    // Adds one to the magnitude.
+    void incAbs() {
+        for (auto &x : d)
+            if (++x) return;
+        d.push_back(1);
+    }
+
+    // Single-limb divisors with Python signs and without allocating. The
+    // divisor has magnitude m and sign neg: divFloor replaces *this by the
+    // floor quotient, modFloor only computes the remainder; both return
+    // the remainder's magnitude (its sign is neg). divmodSmall / modSmall
+    // take any nonzero long long.
+    limb divFloor(limb m, bool neg) {
+        bool q = opt != neg;
+        limb rem = divSmall(m);
+        opt = q && !d.empty();
+        if (q && rem) {
+            incAbs();
+            opt = true;
+            rem = m - rem;
+        }
+        return rem;
+    }
+    limb modFloor(limb m, bool neg) const {
+        limb rem = 0;
+        for (int i = d.size() - 1; i >= 0; --i) rem = (limb) (((wide) rem << 64 | d[i]) % m);
+        if (rem && opt != neg) rem = m - rem;
+        return rem;
+    }
+    long long divmodSmall(long long v) {
+        limb rem = divFloor(magnitude(v), v < 0);
+        return v < 0 ? -(long long) rem : (long long) rem;
+    }
+    long long modSmall(long long v) const {
+        limb rem = modFloor(magnitude(v), v < 0);
+        return v < 0 ? -(long long) rem : (long long) rem;
     }
 
+    // Division on magnitudes: one limb by divSmall, short quotients or
+    // divisors by Knuth's algorithm D, everything else recursively by
+    // Burnikel-Ziegler on top of the fast multiplication.
+    static const int BURNIKEL = 40;
 
-    friend void div(const int2048 &lhs, const int2048 &rhs, int2048 &rem, int2048 &res) {
-        int rhs_l = rhs.d.back() + 1, rhs_r = rhs.d.back();
-        for (int i = lhs.d.size()  - 1; i >= 0; --i) {
-            rem.shift(lhs.d[i]);
-            if (rem < rhs) {
-                res.d.push_back(0);
-                continue;
+    // Knuth, TAOCP 4.3.1, algorithm D. b has at least two limbs; q and r
+    // receive the magnitudes of a / b and a % b.
+    static void divKnuth(const limbs &a, const limbs &b,
+                         limbs &q, limbs &r) {
+        int n = b.size(), m = a.size() - n;
+        // Shifting both sides left by s bits sets the top bit of the
+        // divisor, which keeps every trial quotient at most two too large.
+        int s = __builtin_clzll(b.back());
+        limbs u(a.size() + 1), v(n);
+        for (int i = n - 1; i >= 0; --i) v[i] = b[i] << s | (s && i ? b[i - 1] >> (64 - s) : 0);
+        u[a.size()] = s ? a.back() >> (64 - s) : 0;
+        for (int i = a.size() - 1; i >= 0; --i) u[i] = a[i] << s | (s && i ? a[i - 1] >> (64 - s) : 0);
+        q.assign(m + 1, 0);
+        for (int j = m; j >= 0; --j) {
+            wide num = (wide) u[j + n] << 64 | u[j + n - 1];
+            wide qhat = num / v[n - 1], rhat = num % v[n - 1];
+            while (qhat >> 64 || qhat * v[n - 2] > (rhat << 64 | u[j + n - 2])) {
+                --qhat, rhat += v[n - 1];
+                if (rhat >> 64) break;
             }
-            int l, r;
-            if (rem.d.size() == rhs.d.size()) {
-                l = rem.d.back() / rhs_l;
-                r = (rem.d.back() + 1) / rhs_r;
-            } else {
-                l = (1ll * rem.d.back() * base + rem.d[rem.d.size() - 2]) / rhs_l;
-                r = (1ll * rem.d.back() * base + rem.d[rem.d.size() - 2] + 1) / rhs_r;
+            // u[j, j + n] -= qhat * v
+            limb borrow = 0, carry = 0;
+            for (int i = 0; i < n; ++i) {
+                wide p = qhat * v[i] + carry;
+                carry = (limb) (p >> 64);
+                limb lo = (limb) p, t = u[i + j] - lo - borrow;
+                borrow = u[i + j] < lo || u[i + j] - lo < borrow;
+                u[i + j] = t;
             }
-            if (l < 1) l = 1;
-            if (r >= base) r = base - 1;
-            while (l < r) {
-                int mid = (l + r + 1) >> 1;
-                if (rhs * int2048(mid) <= rem) 
-                    l = mid;
-                else r = mid - 1;
+            bool negative = u[j + n] < carry || u[j + n] - carry < borrow;
+            u[j + n] -= carry + borrow;
+            if (negative) {
+                // qhat was one too large: add v back
+                --qhat;
+                u[j + n] += limbk::add(u.data() + j, u.data() + j, v.data(), n);
             }
-            res.d.push_back(l);
-            rem -= rhs * int2048(l);
+            q[j] = (limb) qhat;
         }
-        std::reverse(res.d.begin(), res.d.end());
-        while (!res.d.empty() && !res.d.back()) res.d.pop_back();
+        trim(q);
+        r.resize(n);
+        for (int i = 0; i < n; ++i) r[i] = u[i] >> s | (s && i + 1 < n ? u[i + 1] << (64 - s) : 0);
+        trim(r);
+    }
+
+    static int2048 lowLimbs(const int2048 &x, size_t k) { return fromLimbs(slice(x.d, 0, k)); }
+    static int2048 highLimbs(const int2048 &x, size_t k) { return fromLimbs(slice(x.d, k, x.d.size())); }
+    // x * 2^(64k)
+    static int2048 shl(int2048 x, size_t k) {
+        if (!x.d.empty()) x.d.insert(x.d.begin(), k, 0);
+        return x;
+    }
+    // x * 2^s, x / 2^s for 0 <= s < 64
+    static int2048 shlBits(int2048 x, int s) {
+        if (!s || x.d.empty()) return x;
+        x.d.push_back(0);
+        for (int i = x.d.size() - 1; i >= 0; --i) x.d[i] = x.d[i] << s | (i ? x.d[i - 1] >> (64 - s) : 0);
+        trim(x.d);
+        return x;
+    }
+    static int2048 shrBits(int2048 x, int s) {
+        if (!s) return x;
+        for (size_t i = 0; i < x.d.size(); ++i)
+            x.d[i] = x.d[i] >> s | (i + 1 < x.d.size() ? x.d[i + 1] << (64 - s) : 0);
+        trim(x.d);
+        return x;
+    }
+
+    // Burnikel and Ziegler, "Fast recursive division" (1998). B has n limbs
+    // with the top bit set, and A < B * 2^(64n).
+    static void div2n1n(const int2048 &A, const int2048 &B, int n, int2048 &Q, int2048 &R) {
+        if ((n & 1) || n < BURNIKEL) {
+            Q = R = int2048();
+            divAbs(A.d, B.d, Q.d, R.d);
+            return;
+        }
+        int h = n / 2;
+        int2048 q1, q2, S;
+        div3n2n(highLimbs(A, h), B, h, q1, S);
+        div3n2n(shl(S, h) + lowLimbs(A, h), B, h, q2, R);
+        Q = shl(q1, h) + q2;
+    }
+    // A has at most 3h limbs, B 2h normalised limbs, and A < B * 2^(64h).
+    static void div3n2n(const int2048 &A, const int2048 &B, int h, int2048 &Q, int2048 &R) {
+        int2048 b1 = highLimbs(B, h), R1;
+        int2048 a12 = highLimbs(A, h);
+        if (highLimbs(A, 2 * h) < b1) div2n1n(a12, b1, h, Q, R1);
+        else {
+            Q = shl(int2048(1), h) - int2048(1);
+            R1 = a12 - shl(b1, h) + b1;
+        }
+        R = shl(R1, h) + lowLimbs(A, h) - Q * lowLimbs(B, h);
+        while (R.opt) {
+            Q -= int2048(1);
+            R += B;
+        }
+    }
+    static void divBurnikel(const int2048 &a, const int2048 &b, int2048 &q, int2048 &r) {
+        // Pad the divisor to n = j * 2^k limbs with j < BURNIKEL, so that
+        // div2n1n halves evenly down to the Knuth base case.
+        int s = b.d.size(), k = 0;
+        while ((s >> k) >= BURNIKEL) ++k;
+        int n = ((s + (1 << k) - 1) >> k) << k;
+        int bits = __builtin_clzll(b.d.back());
+        int2048 B = shl(shlBits(b, bits), n - s), A = shl(shlBits(a, bits), n - s);
+        // A < 2^(64 (t n - 1)), so its top block is below B
+        int t = std::max<int>(2, (A.d.size() + n) / n);
+        int2048 Z = highLimbs(A, (t - 2) * n), Qi, R;
+        q = int2048();
+        q.d.assign((t - 1) * n, 0);
+        for (int i = t - 2; i >= 0; --i) {
+            div2n1n(Z, B, n, Qi, R);
+            std::copy(Qi.d.begin(), Qi.d.end(), q.d.begin() + i * n);
+            if (i) Z = shl(R, n) + lowLimbs(highLimbs(A, (i - 1) * n), n);
+        }
+        trim(q.d);
+        r = shrBits(highLimbs(R, n - s), bits);
+    }
+
+    static void divAbs(const limbs &a, const limbs &b,
+                       limbs &q, limbs &r) {
+        q.clear(), r.clear();
+        if (a.size() < b.size() || (a.size() == b.size() && cmpAbs(a, b) < 0)) {
+            r = a;
+            return;
+        }
+        if (b.size() == 1) {
+            int2048 x = fromLimbs(a);
+            limb rem = x.divSmall(b[0]);
+            q = std::move(x.d);
+            if (rem) r.push_back(rem);
+        } else if ((int) b.size() < BURNIKEL || (int) (a.size() - b.size()) < BURNIKEL)
+            divKnuth(a, b, q, r);
+        else {
+            int2048 Q, R;
+            divBurnikel(fromLimbs(a), fromLimbs(b), Q, R);
+            q = std::move(Q.d), r = std::move(R.d);
+        }
+    }
+
+    // Python floor division and modulo (the remainder takes the sign of
+    // rhs) from a single division. Dividing by zero gives zeros.
+    friend void divmod(const int2048 &lhs, const int2048 &rhs, int2048 &q, int2048 &r) {
+        int2048 quo, rem;
+        if (rhs.d.size() == 1) {
+            quo = lhs;
+            limb x = quo.divFloor(rhs.d[0], rhs.opt);
+            if (x) rem.d.push_back(x), rem.opt = rhs.opt;
+        } else if (!rhs.d.empty()) {
+            divAbs(lhs.d, rhs.d, quo.d, rem.d);
+            bool neg = lhs.opt != rhs.opt;
+            quo.opt = neg && !quo.d.empty();
+            if (!rem.d.empty()) {
+                if (neg) {
+                    quo.incAbs();
+                    quo.opt = true;
+                    limbs t = rhs.d;
+                    subAbs(t, rem.d);
+                    rem.d.swap(t);
+                }
+                rem.opt = rhs.opt;
+            }
+        }
+        q.d.swap(quo.d), q.opt = quo.opt;
+        r.d.swap(rem.d), r.opt = rem.opt;
     }
     friend int2048 operator/(const int2048 &lhs, const int2048 &rhs) {
-        int2048 rem, res;
+        int2048 q, r;
+        divmod(lhs, rhs, q, r);
+        return q;
+    }
+    friend int2048 operator%(const int2048 &lhs, const int2048 &rhs) {
+        int2048 q, r;
+        divmod(lhs, rhs, q, r);
+        return r;
+    }
+    int2048 &operator/=(const int2048 &rhs) {
+        if (rhs.d.size() == 1) divFloor(rhs.d[0], rhs.opt);
+        else *this = *this / rhs;
+        return *this;
+    }
+    int2048 &operator%=(const int2048 &rhs) {
+        if (rhs.d.size() == 1) {
+            limb x = modFloor(rhs.d[0], rhs.opt);
+            d.clear();
+            if (x) d.push_back(x);
+            opt = x && rhs.opt;
+        } else *this = *this % rhs;
+        return *this;
+    }
+
+    // Exponentiation. Exponents of more than a few bits are scanned in
+    // sliding windows of up to 4 bits over a table of odd powers, with
+    // mul as the (modular) product; e is nonzero.
+    template <class T, class Mul>
+    static T powWindow(const T &x, const limbs &e, Mul mul) {
+        int bits = e.size() * 64 - __builtin_clzll(e.back()), w = bits > 24 ? 4 : 1;
+        std::vector<T> odd(1, x); // x, x^3, x^5, ..., x^(2^w - 1)
+        if (w > 1) {
+            T x2 = mul(x, x);
+            while ((int) odd.size() < 1 << (w - 1)) odd.push_back(mul(odd.back(), x2));
+        }
+        auto bit = [&](int i) { return (int) (e[i >> 6] >> (i & 63) & 1); };
+        T res = x;
+        // the top bit is set, so the first window starts the result
+        for (int i = bits - 1, started = 0; i >= 0;) {
+            if (!bit(i)) {
+                res = mul(res, res), --i;
+                continue;
+            }
+            int l = std::max(i - w + 1, 0), v = 0;
+            while (!bit(l)) ++l;
+            for (int j = i; j >= l; --j) {
+                v = v << 1 | bit(j);
+                if (started) res = mul(res, res);
+            }
+            res = started ? mul(res, odd[v >> 1]) : odd[v >> 1];
+            started = 1, i = l - 1;
+        }
+        return res;
+    }
+
+    // x^e mod m for x < m. Odd moduli use Montgomery's REDC with the
+    // inverse of m modulo 2^64 (Newton's iteration doubles the correct low
+    // bits from 3), t * 2^-64 mod m = hi(t) - hi(u * m) for u = lo(t) / m.
+    static limb powmodLimb(limb x, const limbs &e, limb m) {
+        if (!(m & 1)) return powWindow<limb>(x, e, [m](limb a, limb b) { return (limb) ((wide) a * b % m); });
+        limb inv = m;
+        for (int i = 0; i < 5; ++i) inv *= 2 - m * inv;
+        auto mul = [m, inv](limb a, limb b) {
+            wide t = (wide) a * b;
+            limb h = (limb) (t >> 64), s = (limb) ((wide) ((limb) t * inv) * m >> 64);
+            return h >= s ? h - s : h - s + m;
+        };
+        limb r = (0 - m) % m, r2 = (limb) ((wide) r * r % m); // 2^64, 2^128 mod m
+        return mul(powWindow<limb>(mul(x, r2), e, mul), 1);
+    }
+
+    // t * 2^(-64k) mod m for t < m^2, m odd with k limbs; inv = -1 / m[0]
+    // modulo 2^64. Each step clears the lowest limb with a row of addMul.
+    static limbs montRedc(limbs t, const limbs &m, limb inv) {
+        int k = m.size();
+        t.resize(2 * k + 1);
+        for (int i = 0; i < k; ++i) {
+            limb c = limbk::addMul(t.data() + i, m.data(), k, t[i] * inv);
+            for (int j = i + k; c; ++j) c = (t[j] += c) < c;
+        }
+        limbs res(t.begin() + k, t.end());
+        trim(res);
+        if (cmpAbs(res, m) >= 0) subAbs(res, m);
+        return res;
+    }
+    static limbs powmodMontgomery(const limbs &x, const limbs &e, const limbs &m) {
+        int k = m.size();
+        limb inv = m[0];
+        for (int i = 0; i < 5; ++i) inv *= 2 - m[0] * inv;
+        inv = 0 - inv;
+        limbs q, xm;
+        divAbs(shl(fromLimbs(x), k).d, m, q, xm);
+        auto mul = [&](const limbs &a, const limbs &b) { return montRedc(mulAbs(a, b), m, inv); };
+        return montRedc(powWindow<limbs>(xm, e, mul), m, inv);
+    }
+
+    // Barrett: with mu = floor(2^(128k) / m), the quotient estimate from
+    // the top limbs of t is at most two short, for t < 2^(128k).
+    static int2048 powmodBarrett(const int2048 &x, const limbs &e, const int2048 &m) {
+        int k = m.d.size();
+        int2048 mu = shl(int2048(1), 2 * k) / m;
+        auto mul = [&](const int2048 &a, const int2048 &b) {
+            int2048 t = a * b;
+            t -= highLimbs(highLimbs(t, k - 1) * mu, k + 1) * m;
+            while (cmpAbs(t, m) >= 0) t -= m;
+            return t;
+        };
+        return powWindow<int2048>(x, e, mul);
+    }
+
+    // base^e by left-to-right squaring, so that the multiplies are by the
+    // short base.
+    static int2048 pow(const int2048 &base, limb e) {
+        if (!e) return int2048(1);
+        int2048 res = base;
+        for (int i = 62 - __builtin_clzll(e); i >= 0; --i) {
+            res *= res;
+            if (e >> i & 1) res *= base;
+        }
+        return res;
+    }
+    // base^e mod m for e >= 0 and m != 0; like %, the result takes the
+    // sign of m.
+    static int2048 powmod(const int2048 &base, const int2048 &e, const int2048 &m) {
+        int2048 mag = m, res;
+        mag.opt = 0;
+        int2048 x = base % mag;
+        if (e.d.empty()) res = int2048(1) % mag;
+        else if (mag.d.size() == 1) {
+            limb v = powmodLimb(x.d.empty() ? 0 : x.d[0], e.d, mag.d[0]);
+            if (v) res.d.push_back(v);
+        } else if (mag.d[0] & 1) res = fromLimbs(powmodMontgomery(x.d, e.d, mag.d));
+        else res = powmodBarrett(x, e.d, mag);
+        if (m.opt && !res.d.empty()) res += m;
+        return res;
+    }
+
+    // Bitwise operators with Python's semantics: a negative number acts as
+    // its infinite two's complement. Negative operands are complemented
+    // limb by limb on the fly (~(|x| - 1)), and so is a negative result;
+    // two non-negative operands take a plain limb loop.
+    template <class Op>
+    static int2048 bitwise(const int2048 &lhs, const int2048 &rhs, Op f) {
+        size_t nx = lhs.d.size(), ny = rhs.d.size(), n = std::max(nx, ny) + 1;
+        int2048 res;
+        res.d.resize(n);
         if (!lhs.opt && !rhs.opt) {
-            div(lhs, rhs, rem, res);
-            return res;
-        } else if (lhs.opt && rhs.opt) {
-            div(-lhs, -rhs, rem, res);
+            for (size_t i = 0; i < n; ++i) res.d[i] = f(i < nx ? lhs.d[i] : 0, i < ny ? rhs.d[i] : 0);
+            trim(res.d);
             return res;
-        } else if (!lhs.opt && rhs.opt) {
-            div(lhs, -rhs, rem, res);
-            if (rem.d.size()) res = res + int2048(1);
-            return -res;
-        } else {
-            div(-lhs, rhs, rem, res);
-            if (rem.d.size()) res = res + int2048(1);
-            return -res;
         }
+        bool neg = f((limb) lhs.opt, (limb) rhs.opt) & 1;
+        limb bx = lhs.opt, by = rhs.opt, bz = neg;
+        for (size_t i = 0; i < n; ++i) {
+            limb x = i < nx ? lhs.d[i] : 0, y = i < ny ? rhs.d[i] : 0;
+            if (lhs.opt) x = ~(x - bx), bx = bx && !x;
+            if (rhs.opt) y = ~(y - by), by = by && !y;
+            limb z = f(x, y);
+            if (neg) z = ~z + bz, bz = bz && !z;
+            res.d[i] = z;
+        }
+        trim(res.d);
+        res.opt = neg && !res.d.empty();
+        return res;
     }
-    friend int2048 operator%(const int2048 &lhs, const int2048 &rhs) {
-        int2048 rem, res;
-        if (!lhs.opt && !rhs.opt) {
-            div(lhs, rhs, rem, res);
-            return rem;
-        } else if (lhs.opt && !rhs.opt) {
-            div(-lhs, rhs, rem, res);
-            if (rem.d.size())
-                rem = rhs - rem;
-            return rem;
-        } else if (!lhs.opt && rhs.opt) {
-            div(lhs, -rhs, rem, res);
-            if (rem.d.size())
-                rem = rhs + rem;
-            return rem;
+    friend int2048 operator&(const int2048 &lhs, const int2048 &rhs) {
+        return bitwise(lhs, rhs, [](limb x, limb y) { return x & y; });
+    }
+    friend int2048 operator|(const int2048 &lhs, const int2048 &rhs) {
+        return bitwise(lhs, rhs, [](limb x, limb y) { return x | y; });
+    }
+    friend int2048 operator^(const int2048 &lhs, const int2048 &rhs) {
+        return bitwise(lhs, rhs, [](limb x, limb y) { return x ^ y; });
+    }
+    // ~x == -x - 1
+    int2048 operator~() const { return -(*this + int2048(1)); }
+    // x * 2^k, and floor(x / 2^k): negative x is shifted as -((|x| - 1) >> k) - 1.
+    static int2048 shiftLeft(const int2048 &x, size_t k) {
+        return shlBits(shl(x, k / 64), k % 64);
+    }
+    static int2048 shiftRight(const int2048 &x, size_t k) {
+        if (x.opt) return ~shiftRight(~x, k);
+        if (k / 64 >= x.d.size()) return int2048();
+        return shrBits(highLimbs(x, k / 64), k % 64);
+    }
+
+    // Number theory on top of the operators above.
+    size_t bitLength() const { return d.empty() ? 0 : d.size() * 64 - __builtin_clzll(d.back()); }
+    // 64 bits of the magnitude starting at bit k.
+    static limb bitsAt(const limbs &x, size_t k) {
+        size_t i = k / 64, s = k % 64;
+        limb res = i < x.size() ? x[i] >> s : 0;
+        if (s && i + 1 < x.size()) res |= x[i + 1] << (64 - s);
+        return res;
+    }
+
+    static limb gcdLimb(limb a, limb b) {
+        if (!a || !b) return a | b;
+        int s = __builtin_ctzll(a | b);
+        a >>= __builtin_ctzll(a);
+        while (b) {
+            b >>= __builtin_ctzll(b);
+            if (a > b) std::swap(a, b);
+            b -= a;
+        }
+        return a << s;
+    }
+    // Lehmer (Knuth, TAOCP 4.5.2, algorithm L): Euclid's quotients are
+    // computed on the leading 62 bits for as long as they provably match
+    // those of the full numbers, then applied to the full numbers at once
+    // as a 2x2 cosequence, so that a round costs two linear passes instead
+    // of one long division per quotient.
+    static int2048 gcd(int2048 a, int2048 b) {
+        a.opt = b.opt = 0;
+        if (cmpAbs(a, b) < 0) std::swap(a, b);
+        while (b.d.size() > 1) {
+            size_t k = a.bitLength() - 62;
+            __int128 x = bitsAt(a.d, k), y = bitsAt(b.d, k), A = 1, B = 0, C = 0, D = 1;
+            while (y + C > 0 && y + D > 0) {
+                __int128 q = (x + A) / (y + C), t;
+                if (q != (x + B) / (y + D)) break;
+                t = A - q * C, A = C, C = t;
+                t = B - q * D, B = D, D = t;
+                t = x - q * y, x = y, y = t;
+            }
+            if (!B) {
+                int2048 r = a % b;
+                a = std::move(b), b = std::move(r);
+            } else {
+                // both new values are >= 0 and no longer than a
+                __int128 ca = 0, cb = 0;
+                b.d.resize(a.d.size());
+                for (size_t i = 0; i < a.d.size(); ++i) {
+                    __int128 u = a.d[i], v = b.d[i];
+                    ca += A * u + B * v, cb += C * u + D * v;
+                    a.d[i] = (limb) ca, b.d[i] = (limb) cb;
+                    ca >>= 64, cb >>= 64;
+                }
+                trim(a.d), trim(b.d);
+            }
+        }
+        if (b.d.empty()) return a;
+        limb g = gcdLimb(b.d[0], a.modFloor(b.d[0], false));
+        return fromLimbs(limbs(1, g));
+    }
+
+    // floor(sqrt(x)) for x >= 0: Newton's iteration from above, started
+    // from the square root of the top 52 bits, so that each step doubles
+    // the roughly 26 correct bits.
+    static int2048 isqrt(const int2048 &x) {
+        size_t bits = x.bitLength();
+        if (bits <= 52) {
+            limb v = x.d.empty() ? 0 : x.d[0], r = (limb) std::sqrt((double) v);
+            while (r * r > v) --r;
+            while ((r + 1) * (r + 1) <= v) ++r;
+            return int2048((long long) r);
+        }
+        size_t e = (bits - 51) & ~(size_t) 1;
+        int2048 r = shiftLeft(int2048((long long) std::sqrt((double) bitsAt(x.d, e)) + 2), e / 2);
+        for (;;) {
+            int2048 y = shiftRight(r + x / r, 1);
+            if (!(y < r)) return r;
+            r = std::move(y);
+        }
+    }
+
+    // Binary extended gcd for the inverse of a modulo an odd m > 1, with
+    // x1 * a == u and x2 * a == v (mod m) while u and v shrink like in
+    // the binary gcd. An even m takes the inverse of m modulo an odd a
+    // instead: m t == 1 (mod a) gives a^-1 = -(m t - 1) / a (mod m).
+    static bool modinvOddLimb(limb a, limb m, limb &res) {
+        limb u = a, v = m, x1 = 1, x2 = 0;
+        auto halve = [m](limb &y, limb &c) {
+            for (; !(y & 1); y >>= 1) c = c & 1 ? (limb) (((wide) c + m) >> 1) : c >> 1;
+        };
+        while (u != 1 && v != 1) {
+            if (!u) return false;
+            halve(u, x1), halve(v, x2);
+            if (u >= v) u -= v, x1 = x1 >= x2 ? x1 - x2 : x1 + (m - x2);
+            else v -= u, x2 = x2 >= x1 ? x2 - x1 : x2 + (m - x1);
+        }
+        res = u == 1 ? x1 : x2;
+        return true;
+    }
+    static bool modinvLimb(limb a, limb m, limb &res) {
+        if (m == 1 || a == 1) return res = a % m, true;
+        if (m & 1) return modinvOddLimb(a, m, res);
+        limb t;
+        if (!(a & 1) || !modinvOddLimb(m % a, a, t)) return false;
+        limb k = (limb) (((wide) m * t - 1) / a) % m;
+        res = k ? m - k : 0;
+        return true;
+    }
+    static bool modinvOdd(const int2048 &a, const int2048 &m, int2048 &res) {
+        int2048 u = a, v = m, x1(1), x2(0);
+        auto odd = [](const int2048 &y) { return !y.d.empty() && (y.d[0] & 1); };
+        auto one = [](const int2048 &y) { return y.d.size() == 1 && y.d[0] == 1; };
+        auto halve = [&](int2048 &y, int2048 &c) {
+            while (!odd(y)) {
+                y = shrBits(std::move(y), 1);
+                if (odd(c)) c += m;
+                c = shrBits(std::move(c), 1);
+            }
+        };
+        while (!one(u) && !one(v)) {
+            if (u.d.empty()) return false;
+            halve(u, x1), halve(v, x2);
+            if (cmpAbs(u, v) >= 0) {
+                u -= v, x1 -= x2;
+                if (x1.opt) x1 += m;
+            } else {
+                v -= u, x2 -= x1;
+                if (x2.opt) x2 += m;
+            }
+        }
+        res = one(u) ? x1 : x2;
+        return true;
+    }
+    // a^-1 mod m with the sign of m like %, or false if gcd(a, m) != 1
+    // (or m == 0).
+    static bool modinv(const int2048 &a, const int2048 &m, int2048 &res) {
+        int2048 mag = m;
+        mag.opt = 0;
+        if (mag.d.empty()) return false;
+        int2048 x = a % mag;
+        if (mag.d.size() == 1) {
+            limb r;
+            if (!modinvLimb(x.d.empty() ? 0 : x.d[0], mag.d[0], r)) return false;
+            res = fromLimbs(limbs(1, r));
+        } else if (mag.d[0] & 1) {
+            if (!modinvOdd(x, mag, res)) return false;
         } else {
-            div(-lhs, -rhs, rem, res);
-            return -rem;
+            int2048 t;
+            if (x.d.empty() || !(x.d[0] & 1)) return false;
+            if (x.d.size() == 1 && x.d[0] == 1) res = x;
+            else {
+                if (!modinvOdd(mag % x, x, t)) return false;
+                res = (mag * t - int2048(1)) / x % mag;
+                if (!res.d.empty()) res = mag - res;
+            }
         }
+        if (m.opt && !res.d.empty()) res += m;
+        return true;
     }
-    int2048 &operator/=(const int2048 &rhs) {
-        *this = *this / rhs;
-        return *this;
+
+    // Miller-Rabin with the first `rounds` primes as bases, after trial
+    // division by them. Below 2^64 the first twelve decide primality
+    // exactly; above, a composite passes a round with probability at most
+    // 1/4.
+    static bool isProbablePrime(const int2048 &n, int rounds) {
+        static const int P[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+                                59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131};
+        if (n.opt || n.bitLength() < 2) return false;
+        for (int p : P) {
+            if (n == int2048(p)) return true;
+            if (!n.modSmall(p)) return false;
+        }
+        int2048 n1 = n - int2048(1), one(1);
+        size_t s = 0;
+        while (!(bitsAt(n1.d, s) & 1)) ++s;
+        int2048 d = shiftRight(n1, s);
+        rounds = n.d.size() == 1 ? 12 : std::min(std::max(rounds, 1), (int) (sizeof P / sizeof *P));
+        for (int i = 0; i < rounds; ++i) {
+            int2048 x = powmod(int2048(P[i]), d, n);
+            if (x == one || x == n1) continue;
+            size_t r = 1;
+            for (; r < s; ++r) {
+                x = x * x % n;
+                if (x == n1 || x == one) break;
+            }
+            if (r == s || x == one) return false;
+        }
+        return true;
     }
 
     friend std::istream &operator>>(std::istream &lhs, int2048 &rhs) {
@@ -277,13 +1065,31 @@ public:
         return !d.empty();
     }
     explicit operator int() const {
-        return d.size() ? (opt ? -d[0] : d[0]) : 0;
+        return d.size() ? (opt ? -(int) d[0] : (int) d[0]) : 0;
     }
+    // Rounded to nearest, ties to even, like Python's float(int): the top
+    // 64 bits with the rest folded into a sticky bit round exactly once.
     explicit operator double() const {
-        double res = 0;
-        for (auto x : d)
-            res = res * base + x;
-        if (opt) res = -res;
+        size_t bits = bitLength(), s = bits > 64 ? bits - 64 : 0;
+        if (bits > 1024) return opt ? -HUGE_VAL : HUGE_VAL;
+        limb top = bitsAt(d, s);
+        if (s) {
+            bool sticky = false;
+            for (size_t i = 0; i < s / 64 && !sticky; ++i) sticky = d[i];
+            if (s % 64 && !sticky) sticky = d[s / 64] << (64 - s % 64);
+            top |= sticky;
+        }
+        double res = std::ldexp((double) top, (int) s);
+        return opt ? -res : res;
+    }
+    // Truncated toward zero; 0 for nan and infinities.
+    static int2048 fromDouble(double x) {
+        if (!std::isfinite(x) || std::fabs(x) < 1) return int2048();
+        int e;
+        limb m = (limb) std::ldexp(std::frexp(std::fabs(x), &e), 53);
+        e -= 53;
+        int2048 res = e >= 0 ? shiftLeft(fromLimbs(limbs(1, m)), e) : fromLimbs(limbs(1, m >> -e));
+        res.opt = x < 0;
         return res;
     }
 };
@@ -291,4 +1097,4 @@ public:
 static int2048 add(int2048 lhs, const int2048 &rhs) { lhs.add(rhs); return lhs; }
 static int2048 minus(int2048 lhs, const int2048 &rhs) { lhs.minus(rhs); return lhs; }
 
-#endif
\ No newline at end of file
+#endif
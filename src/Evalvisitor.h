@@ -9,6 +9,8 @@
 #include "Exception.h"
 #include "utils.h"
 #include "BaseType.h"
+#include "Generator.h"
+#include "Arena.h"
 
 #include <iostream>
 #include <stack>
@@ -26,12 +28,245 @@ public:
         Scope scope;
         Python3Parser::SuiteContext *suite;
         std::vector<std::string> testlist;
-        Func() : scope() { suite = nullptr; }
+        bool generator;
+        Func() : scope() { suite = nullptr; generator = false; }
     };
 
+    // Argument lists and testlist values live in the statement's arena;
+    // whatever outlives the statement is copied out of it.
+    typedef std::vector<std::pair<std::string, BaseType>, arena::Allocator<std::pair<std::string, BaseType> > > ArgList;
+    typedef std::vector<BaseType, arena::Allocator<BaseType> > ValueList;
+    typedef antlrcpp::Any (EvalVisitor::*BuiltinFunc)(ArgList &);
+
     std::stack<Scope> Local;
     Scope Global;
     std::unordered_map<std::string, Func> Function;
+    std::unordered_map<std::string, BuiltinFunc> Builtin;
+
+    // The last division by a big integer in visitTerm, so that `a // b` and
+    // `a % b` on the same operands in one statement or the next divide
+    // once. Dropped after a statement that does not use it.
+    struct DivMemo {
+        BaseType lhs, rhs, q, r;
+        bool used;
+        DivMemo() : used(false) {}
+    } lastDiv;
+
+    EvalVisitor() {
+        Builtin["print"] = &EvalVisitor::builtinPrint;
+        Builtin["exit"] = &EvalVisitor::builtinExit;
+        Builtin["int"] = &EvalVisitor::builtinInt;
+        Builtin["float"] = &EvalVisitor::builtinFloat;
+        Builtin["str"] = &EvalVisitor::builtinStr;
+        Builtin["bool"] = &EvalVisitor::builtinBool;
+        Builtin["repr"] = &EvalVisitor::builtinRepr;
+        Builtin["next"] = &EvalVisitor::builtinNext;
+        Builtin["getitem"] = &EvalVisitor::builtinGetitem;
+        Builtin["getslice"] = &EvalVisitor::builtinGetslice;
+        Builtin["len"] = &EvalVisitor::builtinLen;
+        Builtin["find"] = &EvalVisitor::builtinFind;
+        Builtin["count"] = &EvalVisitor::builtinCount;
+        Builtin["replace"] = &EvalVisitor::builtinReplace;
+        Builtin["split"] = &EvalVisitor::builtinSplit;
+        Builtin["divmod"] = &EvalVisitor::builtinDivmod;
+        Builtin["pow"] = &EvalVisitor::builtinPow;
+        Builtin["and_"] = &EvalVisitor::builtinAnd;
+        Builtin["or_"] = &EvalVisitor::builtinOr;
+        Builtin["xor"] = &EvalVisitor::builtinXor;
+        Builtin["invert"] = &EvalVisitor::builtinInvert;
+        Builtin["lshift"] = &EvalVisitor::builtinLshift;
+        Builtin["rshift"] = &EvalVisitor::builtinRshift;
+        Builtin["gcd"] = &EvalVisitor::builtinGcd;
+        Builtin["isqrt"] = &EvalVisitor::builtinIsqrt;
+        Builtin["modinv"] = &EvalVisitor::builtinModinv;
+        Builtin["is_probable_prime"] = &EvalVisitor::builtinIsProbablePrime;
+    }
+
+    antlrcpp::Any builtinPrint(ArgList &var) {
+        for (auto &i : var)
+            i.second.print(' ');
+        cout << endl;
+        return BaseType(0, -1);
+    }
+
+    antlrcpp::Any builtinExit(ArgList &var) {
+        exit(0);
+    }
+
+    antlrcpp::Any builtinInt(ArgList &var) {
+        return BaseType((int2048)var[0].second);
+    }
+
+    antlrcpp::Any builtinFloat(ArgList &var) {
+        return BaseType((double)var[0].second);
+    }
+
+    antlrcpp::Any builtinStr(ArgList &var) {
+        return BaseType((std::string)var[0].second);
+    }
+
+    antlrcpp::Any builtinBool(ArgList &var) {
+        return BaseType((bool)var[0].second);
+    }
+
+    antlrcpp::Any builtinRepr(ArgList &var) {
+        return BaseType(var[0].second.repr());
+    }
+
+    antlrcpp::Any builtinDivmod(ArgList &var) {
+        std::vector<BaseType> res(2);
+        divmod(var[0].second, var[1].second, res[0], res[1]);
+        return res;
+    }
+
+    antlrcpp::Any builtinPow(ArgList &var) {
+        if (var.size() > 2 && var[2].second.t) return powmod(var[0].second, var[1].second, var[2].second);
+        return power(var[0].second, var[1].second);
+    }
+
+    // The grammar has no rules for &, |, ^, ~, << and >>, so they are
+    // builtins named after Python's operator module.
+    antlrcpp::Any builtinAnd(ArgList &var) { return bitwise(var[0].second, var[1].second, '&'); }
+    antlrcpp::Any builtinOr(ArgList &var) { return bitwise(var[0].second, var[1].second, '|'); }
+    antlrcpp::Any builtinXor(ArgList &var) { return bitwise(var[0].second, var[1].second, '^'); }
+    antlrcpp::Any builtinInvert(ArgList &var) { return invert(var[0].second); }
+    antlrcpp::Any builtinLshift(ArgList &var) { return shift(var[0].second, var[1].second, true); }
+    antlrcpp::Any builtinRshift(ArgList &var) { return shift(var[0].second, var[1].second, false); }
+
+    antlrcpp::Any builtinGcd(ArgList &var) {
+        BaseType res(0ll);
+        for (auto &i : var) res = gcd(res, i.second);
+        return res;
+    }
+    antlrcpp::Any builtinIsqrt(ArgList &var) { return isqrt(var[0].second); }
+    antlrcpp::Any builtinModinv(ArgList &var) { return modinv(var[0].second, var[1].second); }
+    // is_probable_prime(n, rounds = 25)
+    antlrcpp::Any builtinIsProbablePrime(ArgList &var) {
+        long long rounds = 25;
+        if (var.size() > 1) var[1].second.small(rounds);
+        return isProbablePrime(var[0].second, (int) std::min(rounds, 64ll));
+    }
+
+    antlrcpp::Any builtinNext(ArgList &var) {
+        Generator *gen = var[0].second.gen();
+        if (gen) {
+            auto res = resume(*gen);
+            if (res.first) return res.second;
+        }
+        return var.size() > 1 ? var[1].second : BaseType();
+    }
+
+    antlrcpp::Any builtinGetitem(ArgList &var) {
+        const Str &s = var[0].second.text();
+        long long len = s.length();
+        int2048 k = (int2048) var[1].second;
+        if (var[0].second.t != 4 || k < int2048(-len) || k >= int2048(len)) return BaseType();
+        size_t l = s.offset(sliceIndex(var[1].second, len, 0));
+        return BaseType(s.substr(l, s.ascii() ? 1 : s.offset(s.index(l) + 1) - l));
+    }
+
+    antlrcpp::Any builtinGetslice(ArgList &var) {
+        if (var[0].second.t != 4) return BaseType(Str());
+        const Str &s = var[0].second.text();
+        std::pair<size_t, size_t> range;
+        sliceBytes(s, var, 1, range);
+        return BaseType(s.substr(range.first, range.second - range.first));
+    }
+
+    // Byte range of s[start:end], start / end being the optional arguments var[i], var[i + 1];
+    // an empty range keeps its start. False when start lies past the end of s or after end,
+    // where find and count have no position to match at, not even for "".
+    static bool sliceBytes(const Str &s, const ArgList &var, size_t i, std::pair<size_t, size_t> &range) {
+        long long len = s.length();
+        long long l = var.size() > i ? sliceIndex(var[i].second, len, 0) : 0;
+        long long r = var.size() > i + 1 ? sliceIndex(var[i + 1].second, len, len) : len;
+        range = std::make_pair(s.offset(l), s.offset(std::max(l, r)));
+        return l <= r && !(var.size() > i && var[i].second.t && (int2048) var[i].second > int2048(len));
+    }
+
+    antlrcpp::Any builtinLen(ArgList &var) {
+        if (var[0].second.t != 4) return BaseType();
+        return BaseType(int2048((long long) var[0].second.text().length()));
+    }
+
+    antlrcpp::Any builtinFind(ArgList &var) {
+        const Str &s = var[0].second.text(), &t = var[1].second.text();
+        std::pair<size_t, size_t> range;
+        if (!sliceBytes(s, var, 2, range)) return BaseType(int2048(-1));
+        size_t k = strk::find(s.data(), range.second, t.data(), t.size(), range.first);
+        if (k == strk::npos) return BaseType(int2048(-1));
+        return BaseType(int2048((long long) s.index(k)));
+    }
+
+    antlrcpp::Any builtinCount(ArgList &var) {
+        const Str &s = var[0].second.text(), &t = var[1].second.text();
+        std::pair<size_t, size_t> range;
+        if (!sliceBytes(s, var, 2, range)) return BaseType(int2048(0));
+        size_t res = 0;
+        if (t.empty()) res = s.index(range.second) - s.index(range.first) + 1;
+        else if (t.size() == 1) res = strk::countByte(s.data() + range.first, range.second - range.first, t[0]);
+        else {
+            size_t k = strk::find(s.data(), range.second, t.data(), t.size(), range.first);
+            for (; k != strk::npos; ++res)
+                k = strk::find(s.data(), range.second, t.data(), t.size(), k + t.size());
+        }
+        return BaseType(int2048((long long) res));
+    }
+
+    antlrcpp::Any builtinReplace(ArgList &var) {
+        const Str &s = var[0].second.text(), &t = var[1].second.text(), &u = var[2].second.text();
+        // counts beyond long long are as good as unlimited
+        long long cnt = -1;
+        if (var.size() > 3) var[3].second.small(cnt);
+        std::string res;
+        size_t last = 0;
+        if (t.empty()) {
+            for (size_t i = 0; i <= s.size() && cnt; ++i)
+                if (i == s.size() || strk::isLead(s[i])) {
+                    res.append(s.data() + last, i - last).append(u.data(), u.size());
+                    last = i, --cnt;
+                }
+        } else {
+            for (size_t k = strk::find(s.data(), s.size(), t.data(), t.size()); k != strk::npos && cnt; --cnt) {
+                res.append(s.data() + last, k - last).append(u.data(), u.size());
+                last = k + t.size();
+                k = strk::find(s.data(), s.size(), t.data(), t.size(), last);
+            }
+        }
+        if (!last && res.empty()) return BaseType(s);
+        res.append(s.data() + last, s.size() - last);
+        return BaseType(std::move(res));
+    }
+
+    antlrcpp::Any builtinSplit(ArgList &var) {
+        const Str &s = var[0].second.text();
+        long long cnt = -1;
+        if (var.size() > 2) var[2].second.small(cnt);
+        std::vector<BaseType> res;
+        size_t i = 0, n = s.size();
+        if (var.size() < 2 || !var[1].second.t) {
+            auto space = [&](size_t k) { return strchr(" \t\n\r\f\v", s[k]) && s[k]; };
+            while (true) {
+                while (i < n && space(i)) ++i;
+                if (i == n) break;
+                size_t j = i;
+                if (cnt--) while (j < n && !space(j)) ++j;
+                else j = n;
+                res.push_back(BaseType(s.substr(i, j - i)));
+                i = j;
+            }
+        } else {
+            const Str &t = var[1].second.text();
+            size_t k = strk::find(s.data(), n, t.data(), t.size());
+            for (; k != strk::npos && cnt-- && !t.empty(); k = strk::find(s.data(), n, t.data(), t.size(), i)) {
+                res.push_back(BaseType(s.substr(i, k - i)));
+                i = k + t.size();
+            }
+            res.push_back(BaseType(s.substr(i, n - i)));
+        }
+        if (res.size() == 1) return res[0];
+        return res;
+    }
 
     virtual antlrcpp::Any visitFile_input(Python3Parser::File_inputContext *ctx) override {
         return visitChildren(ctx);
@@ -47,10 +282,118 @@ public:
         for (int i = varName.size() - 1, j = varData.size() - 1; j >= 0; --i, --j)
             now.scope.varRegister(varName[i], varData[j]);
         now.suite = ctx->suite(); // TODO
+        now.generator = hasYield(now.suite);
         Function[funcName] = now;
         return 0;
     } //funcdef: 'def' NAME parameters ':' suite;
 
+    // `yield` is not a keyword of our grammar, so a yield statement is an
+    // expression statement consisting of nothing but a call `yield(...)`.
+    static Python3Parser::TrailerContext *yieldCall(Python3Parser::Simple_stmtContext *ctx) {
+        auto expr = ctx->small_stmt()->expr_stmt();
+        if (!expr || expr->augassign() || expr->testlist().size() != 1) return nullptr;
+        auto test = expr->testlist()[0]->test();
+        if (test.size() != 1) return nullptr;
+        auto andTest = test[0]->or_test()->and_test();
+        if (andTest.size() != 1) return nullptr;
+        auto notTest = andTest[0]->not_test();
+        if (notTest.size() != 1 || !notTest[0]->comparison()) return nullptr;
+        auto arith = notTest[0]->comparison()->arith_expr();
+        if (arith.size() != 1) return nullptr;
+        auto term = arith[0]->term();
+        if (term.size() != 1) return nullptr;
+        auto factor = term[0]->factor();
+        if (factor.size() != 1 || !factor[0]->atom_expr()) return nullptr;
+        auto atomExpr = factor[0]->atom_expr();
+        if (!atomExpr->trailer() || atomExpr->atom()->getText() != "yield") return nullptr;
+        return atomExpr->trailer();
+    }
+
+    static bool hasYield(Python3Parser::SuiteContext *ctx) {
+        if (ctx->simple_stmt()) return yieldCall(ctx->simple_stmt()) != nullptr;
+        for (auto x : ctx->stmt()) {
+            if (x->simple_stmt()) {
+                if (yieldCall(x->simple_stmt())) return true;
+                continue;
+            }
+            auto compound = x->compound_stmt();
+            if (compound->while_stmt() && hasYield(compound->while_stmt()->suite())) return true;
+            if (compound->if_stmt())
+                for (auto suite : compound->if_stmt()->suite())
+                    if (hasYield(suite)) return true;
+        }
+        return false;
+    }
+
+    // Runs a generator until its next yield. Returns false once it is exhausted.
+    std::pair<bool, BaseType> resume(Generator &gen) {
+        std::pair<bool, BaseType> res(false, BaseType());
+        if (gen.finished()) return res;
+        Local.push(std::move(gen.scope));
+        while (!gen.finished()) {
+            arena::Guard guard;
+            auto &frame = gen.frames.back();
+            if (frame.loop) {
+                auto loop = frame.loop;
+                if (condition(loop->test()))
+                    gen.frames.push_back(Generator::Frame(loop->suite()));
+                else gen.frames.pop_back();
+                continue;
+            }
+
+            Python3Parser::Simple_stmtContext *simple = frame.simple;
+            Python3Parser::StmtContext *stmt = nullptr;
+            if (simple) {
+                if (frame.pc++) simple = nullptr;
+            } else if (frame.pc < frame.stmt.size()) {
+                stmt = frame.stmt[frame.pc++];
+                simple = stmt->simple_stmt();
+            }
+            if (!simple && !stmt) {
+                gen.frames.pop_back();
+                continue;
+            }
+
+            if (simple) {
+                auto trailer = yieldCall(simple);
+                if (trailer) {
+                    auto var = visitTrailer(trailer).as<ArgList>();
+                    res = std::make_pair(true, var.empty() ? BaseType() : var[0].second);
+                    break;
+                }
+                auto flow = simple->small_stmt()->flow_stmt();
+                if (!flow) {
+                    visitSimple_stmt(simple);
+                    continue;
+                }
+                if (flow->return_stmt()) {
+                    gen.frames.clear();
+                    break;
+                }
+                while (!gen.finished() && !gen.frames.back().loop)
+                    gen.frames.pop_back();
+                if (flow->break_stmt() && !gen.finished())
+                    gen.frames.pop_back();
+                continue;
+            }
+
+            auto compound = stmt->compound_stmt();
+            if (compound->while_stmt()) {
+                gen.frames.push_back(Generator::Frame(compound->while_stmt()));
+            } else if (compound->if_stmt()) {
+                auto test = compound->if_stmt()->test();
+                auto suite = compound->if_stmt()->suite();
+                size_t k = 0;
+                while (k < test.size() && !condition(test[k])) ++k;
+                if (k < suite.size())
+                    gen.frames.push_back(Generator::Frame(suite[k]));
+            } else visitFuncdef(compound->funcdef());
+        }
+        gen.scope = std::move(Local.top());
+        Local.pop();
+        return res;
+    }
+
     virtual antlrcpp::Any visitParameters(Python3Parser::ParametersContext *ctx) override {
         if (ctx->typedargslist())
             return visitTypedargslist(ctx->typedargslist());
@@ -74,8 +417,11 @@ public:
     }
 
     virtual antlrcpp::Any visitStmt(Python3Parser::StmtContext *ctx) override {
-        if (ctx->simple_stmt()) return visitSimple_stmt(ctx->simple_stmt());
-        else return visitCompound_stmt(ctx->compound_stmt());
+        arena::Guard guard;
+        auto res = ctx->simple_stmt() ? visitSimple_stmt(ctx->simple_stmt()) : visitCompound_stmt(ctx->compound_stmt());
+        if (!lastDiv.used) lastDiv = DivMemo();
+        lastDiv.used = false;
+        return res;
     }
 
     virtual antlrcpp::Any visitSimple_stmt(Python3Parser::Simple_stmtContext *ctx) override {
@@ -93,6 +439,11 @@ public:
         return Local.top().varQuery(name).second;
     }
 
+    BaseType *find(const std::string &name) {
+        BaseType *res = Local.empty() ? nullptr : Local.top().varFind(name);
+        return res ? res : Global.varFind(name);
+    }
+
     void write(const std::string& name, const BaseType & var) {
         if (Local.empty()) Global.varRegister(name, var);
         else if (Local.top().varQuery(name).first)  Local.top().varRegister(name, var);
@@ -104,17 +455,24 @@ public:
 
         auto testlistArray = ctx->testlist();
         int arraySize = testlistArray.size();
-        auto varData = visitTestlist(testlistArray[arraySize - 1]).as<std::vector<BaseType> >();
+        auto varData = visitTestlist(testlistArray[arraySize - 1]).as<ValueList>();
+        // names beyond the values (`a = split("")` has none) get None
+        auto value = [&](size_t k) { return k < varData.size() ? varData[k] : BaseType(); };
 
         if (ctx->augassign()) {
             auto varName = testlistArray[0]->getText();
             varName += ',';
             string name; name.clear();
+            int opt = visitAugassign(ctx->augassign()).as<int>();
             for (int j = 0, k = 0, nameSize = varName.size(); j < nameSize; ++j) {
                 if (varName[j] == ',') {
-                    BaseType tmp = read(name);
-                    getAugassign(tmp, varData[k++], visitAugassign(ctx->augassign()).as<int>());
-                    write(name, tmp);
+                    BaseType *slot = find(name);
+                    if (slot) getAugassign(*slot, value(k++), opt);
+                    else {
+                        BaseType tmp = read(name);
+                        getAugassign(tmp, value(k++), opt);
+                        write(name, tmp);
+                    }
                     name.clear();
                 } else name += varName[j];
             }
@@ -127,7 +485,7 @@ public:
             string name; name.clear();
             for (int j = 0, k = 0, nameSize = varName.size(); j < nameSize; ++j) {
                 if (varName[j] == ',') {
-                    write(name, varData[k++]);
+                    write(name, value(k++));
                     name.clear();
                 } else name += varName[j];
             }
@@ -135,8 +493,8 @@ public:
 
 
         if (arraySize > 1) return BaseType(0, -1);
-        else if (varData.size() > 1) return varData;
-        else return varData[0];
+        else if (varData.size() > 1) return std::vector<BaseType>(varData.begin(), varData.end());
+        else return value(0);
     }
 
     virtual antlrcpp::Any visitAugassign(Python3Parser::AugassignContext *ctx) override {
@@ -163,9 +521,9 @@ public:
 
     virtual antlrcpp::Any visitReturn_stmt(Python3Parser::Return_stmtContext *ctx) override {
         if (ctx->testlist()) {
-            auto res = visitTestlist(ctx->testlist()).as<std::vector<BaseType> >();
+            auto res = visitTestlist(ctx->testlist()).as<ValueList>();
             if (res.size() == 1) return res[0];
-            else return res;
+            else return std::vector<BaseType>(res.begin(), res.end());
         } else return BaseType(0, -4);
     }
 
@@ -178,7 +536,7 @@ public:
         auto suite = ctx->suite();
         auto testSize = test.size();
         for (int i = 0; i < testSize; ++i)
-            if ((bool) visitTest(test[i]).as<BaseType>())
+            if (condition(test[i]))
                 return visitSuite(suite[i]);
 
         if (testSize != suite.size())
@@ -188,7 +546,7 @@ public:
     }
 
     virtual antlrcpp::Any visitWhile_stmt(Python3Parser::While_stmtContext *ctx) override {
-        while ((bool) visitTest(ctx->test()).as<BaseType>()) {
+        while (condition(ctx->test())) {
             auto tmp = visitSuite(ctx->suite());
             if (tmp.is<BaseType>()) {
                 if (tmp.as<BaseType>().isVar())
@@ -224,6 +582,12 @@ public:
         return BaseType(0, -1);
     }
 
+    // A loop or branch condition, with its temporaries dropped right away.
+    bool condition(Python3Parser::TestContext *ctx) {
+        arena::Guard guard;
+        return (bool) visitTest(ctx).as<BaseType>();
+    }
+
     virtual antlrcpp::Any visitTest(Python3Parser::TestContext *ctx) override {
         return visitOr_test(ctx->or_test());
     }
@@ -296,22 +660,80 @@ public:
         return (bool)ctx->ADD();
     }
 
+    // The arith_expr of a factor that is nothing but `( expr )`.
+    static Python3Parser::Arith_exprContext *parenthesized(Python3Parser::FactorContext *ctx) {
+        auto atomExpr = ctx->atom_expr();
+        if (!atomExpr || atomExpr->trailer() || !atomExpr->atom()->test()) return nullptr;
+        auto andTest = atomExpr->atom()->test()->or_test()->and_test();
+        if (andTest.size() != 1) return nullptr;
+        auto notTest = andTest[0]->not_test();
+        if (notTest.size() != 1 || !notTest[0]->comparison()) return nullptr;
+        auto arith = notTest[0]->comparison()->arith_expr();
+        return arith.size() == 1 ? arith[0] : nullptr;
+    }
+
+    // `(x * y) % m`, `(x + y) % m` and `(x - y) % m` go through fusedMod.
+    // Returns false, having evaluated nothing, for any other shape.
+    bool tryFusedMod(Python3Parser::FactorContext *lhs, Python3Parser::FactorContext *m, BaseType &res) {
+        auto arith = parenthesized(lhs);
+        if (!arith) return false;
+        auto t = arith->term();
+        BaseType x, y;
+        int op;
+        if (t.size() == 2) {
+            op = visitAddorsub_op(arith->addorsub_op()[0]).as<bool>() ? 2 : 3;
+            x = visitTerm(t[0]).as<BaseType>();
+            y = visitTerm(t[1]).as<BaseType>();
+        } else {
+            auto f = t[0]->factor();
+            if (t.size() != 1 || f.size() != 2 || visitMuldivmod_op(t[0]->muldivmod_op()[0]).as<int>() != 1)
+                return false;
+            op = 1;
+            x = visitFactor(f[0]).as<BaseType>();
+            y = visitFactor(f[1]).as<BaseType>();
+        }
+        res = fusedMod(x, y, op, visitFactor(m).as<BaseType>());
+        return true;
+    }
+
     virtual antlrcpp::Any visitTerm(Python3Parser::TermContext *ctx) override {
         auto f = ctx->factor();
         auto szf = f.size();
         if (szf == 1) return visitFactor(f[0]); 
-        BaseType res = visitFactor(f[0]).as<BaseType>();
         auto o = ctx->muldivmod_op();
-        for (int i = 1; i < szf; ++i) {
+        BaseType res;
+        size_t i = 1;
+        if (visitMuldivmod_op(o[0]).as<int>() == 4 && tryFusedMod(f[0], f[1], res)) i = 2;
+        else res = visitFactor(f[0]).as<BaseType>();
+        for (; i < szf; ++i) {
             int opt = visitMuldivmod_op(o[i - 1]).as<int>();
+            // x * y % m
+            if (opt == 1 && i + 1 < szf && visitMuldivmod_op(o[i]).as<int>() == 4) {
+                BaseType y = visitFactor(f[i]).as<BaseType>();
+                res = fusedMod(res, y, 1, visitFactor(f[i + 1]).as<BaseType>());
+                ++i;
+                continue;
+            }
             if (opt == 1) res = mul(res, visitFactor(f[i]).as<BaseType>());
             if (opt == 2) res = ddiv(res, visitFactor(f[i]).as<BaseType>());
-            if (opt == 3) res = idiv(res, visitFactor(f[i]).as<BaseType>());
-            if (opt == 4) res = mod(res, visitFactor(f[i]).as<BaseType>());
+            if (opt == 3) res = divide(res, visitFactor(f[i]).as<BaseType>(), true);
+            if (opt == 4) res = divide(res, visitFactor(f[i]).as<BaseType>(), false);
         }
         return res;
     }
 
+    // lhs // rhs or lhs % rhs, through lastDiv for big divisors.
+    BaseType divide(const BaseType &lhs, const BaseType &rhs, bool quotient) {
+        if (rhs.t != 2 || !rhs.big) return quotient ? idiv(lhs, rhs) : mod(lhs, rhs);
+        if (!BaseType::same(lastDiv.lhs, lhs) || !BaseType::same(lastDiv.rhs, rhs)) {
+            BaseType q, r;
+            divmod(lhs, rhs, q, r);
+            lastDiv.lhs = lhs, lastDiv.rhs = rhs, lastDiv.q = q, lastDiv.r = r;
+        }
+        lastDiv.used = true;
+        return quotient ? lastDiv.q : lastDiv.r;
+    }
+
     virtual antlrcpp::Any visitMuldivmod_op(Python3Parser::Muldivmod_opContext *ctx) override {
         if (ctx->DIV()) return 2;
         if (ctx->IDIV()) return 3;
@@ -331,22 +753,10 @@ public:
         auto trailer = ctx->trailer();
         if (!trailer) return visitAtom(ctx->atom());
         auto functionName = ctx->atom()->getText();
-        auto var = visitTrailer(trailer).as<std::vector<std::pair<std::string, BaseType> > >();
-        if (functionName == "print") {
-            for (auto i : var)
-                i.second.print(' ');
-            cout << endl;
-            return BaseType(0, -1);
-        } else if (functionName == "exit") {
-            exit(0);
-        } else if (functionName == "int") {
-            return BaseType((int2048)var[0].second);
-        } else if (functionName == "float") {
-            return BaseType((double)var[0].second);
-        } else if (functionName == "str") {
-            return BaseType((std::string)var[0].second);
-        } else if (functionName == "bool") {
-            return BaseType((bool)var[0].second);
+        auto var = visitTrailer(trailer).as<ArgList>();
+        auto builtin = Builtin.find(functionName);
+        if (builtin != Builtin.end() && !Function.count(functionName)) {
+            return (this->*builtin->second)(var);
         } else {
             const Func &nowFunc = Function[functionName];
             Scope nowScope = nowFunc.scope;
@@ -356,6 +766,8 @@ public:
                     nowScope.varRegister(nowFunc.testlist[idx++], x.second);
                 else nowScope.varRegister(x.first, x.second);
             }
+            if (nowFunc.generator)
+                return BaseType(new Generator(nowScope, nowFunc.suite));
             Local.push(nowScope);
             auto res = visitSuite(nowFunc.suite);
             Local.pop();
@@ -368,12 +780,14 @@ public:
 
     virtual antlrcpp::Any visitTrailer(Python3Parser::TrailerContext *ctx) override {
         if (ctx->arglist()) return visitArglist(ctx->arglist());
-        return std::vector<std::pair<std::string, BaseType> >();
+        return ArgList();
     }
 
     virtual antlrcpp::Any visitAtom(Python3Parser::AtomContext *ctx) override {
         if (ctx->NUMBER()) {
             std::string number = ctx->NUMBER()->getText();
+            long long x;
+            if (stringToLL(number, x)) return BaseType(x);
             std::pair<bool, double> tmp = stringToDouble(number);
             if (tmp.first) return BaseType(tmp.second);
             return BaseType(int2048(number));
@@ -398,8 +812,9 @@ public:
     }
 
     virtual antlrcpp::Any visitTestlist(Python3Parser::TestlistContext *ctx) override {
-        std::vector<BaseType> varData;
+        ValueList varData;
         auto test = ctx->test();
+        varData.reserve(test.size());
         for (auto x : test) {
             auto getTest = visitTest(x);
             if (getTest.is<BaseType>())
@@ -414,15 +829,26 @@ public:
     } // testlist: test (',' test)* (',')?;
 
     virtual antlrcpp::Any visitArglist(Python3Parser::ArglistContext *ctx) override {
-        std::vector<std::pair<std::string, BaseType> > res;
+        ArgList res;
         auto argu = ctx->argument();
-        for (auto x : argu)
-            res.push_back(visit(x).as<std::pair<std::string, BaseType> >());
+        res.reserve(argu.size());
+        for (auto x : argu) {
+            auto arg = visit(x);
+            if (arg.is<std::vector<BaseType> >()) {
+                for (auto &v : arg.as<std::vector<BaseType> >())
+                    res.push_back(std::make_pair(std::string(), v));
+            } else res.push_back(arg.as<std::pair<std::string, BaseType> >());
+        }
         return res;
     } // arglist: argument (',' argument)*  (',')?;
 
     virtual antlrcpp::Any visitArgument(Python3Parser::ArgumentContext *ctx) override {
-        if (!ctx->ASSIGN()) return std::make_pair(std::string(), visitTest(ctx->test()[0]).as<BaseType>());
+        if (!ctx->ASSIGN()) {
+            // several values (or none, as from split("")) pass as that many positional arguments
+            auto arg = visitTest(ctx->test()[0]);
+            if (arg.is<std::vector<BaseType> >()) return arg;
+            return std::make_pair(std::string(), arg.as<BaseType>());
+        }
         else return std::make_pair(ctx->test()[0]->getText(), visitTest(ctx->test()[1]).as<BaseType>());
     } // argument: ( test | test '=' test );
 };
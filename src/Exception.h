@@ -3,7 +3,7 @@
 
 #include <string>
 
-enum ExceptionType {UNDEFINED, UNIMPLEMENTED, INVALID_VARNAME, INVALID_FUNC_CALL};
+enum ExceptionType {UNDEFINED, UNIMPLEMENTED, INVALID_VARNAME, INVALID_FUNC_CALL, ZERO_DIVISION, VALUE_ERROR, OVERFLOW_ERROR};
 
 class Exception {
 
@@ -15,6 +15,9 @@ class Exception {
             if (type == UNIMPLEMENTED) message = "Sorry, Apple Pie do not implement this.";
             else if (type == UNDEFINED) message = "Undefined Variable: " + arg;
             else if (type == INVALID_FUNC_CALL) message = "Invalid function call: " + arg;
+            else if (type == ZERO_DIVISION) message = "ZeroDivisionError: " + arg;
+            else if (type == VALUE_ERROR) message = "ValueError: " + arg;
+            else if (type == OVERFLOW_ERROR) message = "OverflowError: " + arg;
         }    
 
         std::string what() {return message;}
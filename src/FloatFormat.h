@@ -0,0 +1,291 @@
+#ifndef PYTHON_INTERPRETER_FLOATFORMAT_H
+#define PYTHON_INTERPRETER_FLOATFORMAT_H
+
+#include <cstddef>
+#include <cstring>
+
+// Float to text without the locale-aware libc paths: `fixed` gives what
+// printf("%.6f") gives (the exact binary value, rounded half to even) and
+// `repr` gives Python's repr, the shortest digits that read back as the
+// same double (Ryu, by Ulf Adams). Both write into a caller's buffer of at
+// least BUF chars and return the length; neither adds a terminator.
+namespace floatfmt {
+
+    typedef unsigned long long u64;
+    typedef unsigned __int128 u128;
+
+    static const size_t BUF = 352;
+
+    struct Parts {
+        bool neg;
+        int bexp;   // biased exponent field
+        u64 frac;   // fraction field
+    };
+    inline Parts split(double d) {
+        u64 bits;
+        memcpy(&bits, &d, sizeof bits);
+        return {(bits >> 63) != 0, (int) (bits >> 52 & 0x7ff), bits & ((1ull << 52) - 1)};
+    }
+
+    // Decimal digits of v, right-aligned to end; returns the first digit.
+    inline char *digitsBack(char *end, u64 v) {
+        do *--end = (char) ('0' + v % 10), v /= 10;
+        while (v);
+        return end;
+    }
+    inline char *digitsBack(char *end, u128 v) {
+        if (v >> 64 == 0) return digitsBack(end, (u64) v);
+        char *p = digitsBack(end, (u64) (v % 10000000000000000000ull));
+        while (p > end - 19) *--p = '0';
+        return digitsBack(p, (u64) (v / 10000000000000000000ull));
+    }
+    inline size_t append(char *out, size_t n, const char *s, size_t len) {
+        memcpy(out + n, s, len);
+        return n + len;
+    }
+
+    // Integers beyond 128 bits: m * 2^e as 64-bit limbs, peeled off 19
+    // decimal digits at a time.
+    inline size_t bigInteger(char *out, size_t n, u64 m, int e) {
+        u64 x[18] = {};
+        size_t len = e / 64 + 2;
+        x[e / 64] = m << (e % 64);
+        if (e % 64) x[e / 64 + 1] = m >> (64 - e % 64);
+        char tmp[BUF], *end = tmp + BUF, *p = end;
+        while (len && !x[len - 1]) --len;
+        while (len) {
+            u64 rem = 0;
+            for (size_t i = len; i-- > 0;) {
+                u128 cur = (u128) rem << 64 | x[i];
+                x[i] = (u64) (cur / 10000000000000000000ull), rem = (u64) (cur % 10000000000000000000ull);
+            }
+            while (len && !x[len - 1]) --len;
+            char *q = digitsBack(p, rem);
+            if (len) while (q > p - 19) *--q = '0';
+            p = q;
+        }
+        return append(out, n, p, end - p);
+    }
+
+    inline size_t special(char *out, size_t n, const Parts &x) {
+        if (x.frac) return append(out, n, "nan", 3);
+        return append(out, n, "inf", 3);
+    }
+
+    // printf("%.6f", d).
+    inline size_t fixed(char *out, double d) {
+        Parts x = split(d);
+        size_t n = 0;
+        if (x.neg) out[n++] = '-';
+        if (x.bexp == 0x7ff) return special(out, n, x);
+        u64 m = x.bexp ? x.frac | 1ull << 52 : x.frac;
+        int e = (x.bexp ? x.bexp : 1) - 1075;
+        char tmp[48], *end = tmp + sizeof tmp;
+        if (e >= 0) {
+            if (e > 74) n = bigInteger(out, n, m, e);
+            else {
+                char *p = digitsBack(end, (u128) m << e);
+                n = append(out, n, p, end - p);
+            }
+            return append(out, n, ".000000", 7);
+        }
+        // round(m * 10^6 / 2^s), ties to even
+        int s = -e;
+        u128 v = (u128) m * 1000000, q = 0;
+        if (s <= 74) {
+            u128 rem = v & (((u128) 1 << s) - 1), half = (u128) 1 << (s - 1);
+            q = v >> s;
+            q += rem > half || (rem == half && (q & 1));
+        }
+        char *p = digitsBack(end, (u64) (q % 1000000));
+        while (p > end - 6) *--p = '0';
+        *--p = '.';
+        p = digitsBack(p, (u64) (q / 1000000));
+        return append(out, n, p, end - p);
+    }
+
+    // Ryu's tables: POW5[i] is 5^i cut to its top 125 bits and POW5_INV[q]
+    // is floor(2^(pow5bits(q) - 1 + 125) / 5^q) + 1. They are computed on
+    // first use instead of being spelled out: 5^i by repeated
+    // multiplication, and the inverses by dividing a 2^960 by 5 repeatedly,
+    // since floor(floor(x / a) / b) == floor(x / ab).
+    static const int POW5_BITS = 125, POW5_COUNT = 326, POW5_INV_COUNT = 342;
+
+    inline int pow5bits(int e) { return ((e * 1217359) >> 19) + 1; }
+    inline int log10Pow2(int e) { return (e * 78913) >> 18; }
+    inline int log10Pow5(int e) { return (e * 732923) >> 20; }
+
+    struct Tables {
+        u128 pow5[POW5_COUNT], pow5Inv[POW5_INV_COUNT];
+
+        // bits [k, k + 128) of x
+        static u128 window(const u64 *x, int len, int k) {
+            u128 res = 0;
+            for (int b = 0; b < 3; ++b) {
+                int i = k / 64 + b, at = b * 64 - k % 64;
+                if (i >= len || at >= 128) break;
+                u128 w = x[i];
+                res |= at >= 0 ? w << at : w >> -at;
+            }
+            return res;
+        }
+
+        Tables() {
+            const int LEN = 15, N = 960;
+            u64 x[LEN + 1] = {1};
+            for (int i = 0; i < POW5_COUNT; ++i) {
+                int shift = pow5bits(i) - POW5_BITS;
+                pow5[i] = shift >= 0 ? window(x, LEN, shift) : window(x, LEN, 0) << -shift;
+                u64 carry = 0;
+                for (int j = 0; j < LEN; ++j) {
+                    u128 t = (u128) x[j] * 5 + carry;
+                    x[j] = (u64) t, carry = (u64) (t >> 64);
+                }
+            }
+            memset(x, 0, sizeof x);
+            x[N / 64] = 1;
+            for (int q = 0; q < POW5_INV_COUNT; ++q) {
+                pow5Inv[q] = window(x, LEN + 1, N - (pow5bits(q) - 1 + POW5_BITS)) + 1;
+                u64 rem = 0;
+                for (int j = LEN; j >= 0; --j) {
+                    u128 cur = (u128) rem << 64 | x[j];
+                    x[j] = (u64) (cur / 5), rem = (u64) (cur % 5);
+                }
+            }
+        }
+    };
+    inline const Tables &tables() {
+        static const Tables t;
+        return t;
+    }
+
+    inline int pow5Factor(u64 v) {
+        int res = 0;
+        for (; v % 5 == 0; v /= 5) ++res;
+        return res;
+    }
+    inline bool multipleOfPow5(u64 v, int p) { return pow5Factor(v) >= p; }
+    inline bool multipleOfPow2(u64 v, int p) { return !(v & ((1ull << p) - 1)); }
+
+    // (m * mul) >> j for j >= 128.
+    inline u64 mulShift(u64 m, u128 mul, int j) {
+        u128 lo = (u128) m * (u64) mul, hi = (u128) m * (u64) (mul >> 64);
+        return (u64) (((lo >> 64) + hi) >> (j - 64));
+    }
+
+    // The shortest digits of a finite nonzero double: value = digits * 10^exp.
+    inline void shortest(const Parts &x, u64 &digits, int &exp) {
+        int e2;
+        u64 m2;
+        if (x.bexp) e2 = x.bexp - 1075 - 2, m2 = x.frac | 1ull << 52;
+        else e2 = 1 - 1075 - 2, m2 = x.frac;
+        const bool even = !(m2 & 1);
+        const u64 mv = 4 * m2;
+        const unsigned mmShift = x.frac || x.bexp <= 1;
+
+        u64 vr, vp, vm;
+        int e10;
+        bool vmTrailingZeros = false, vrTrailingZeros = false;
+        const Tables &t = tables();
+        if (e2 >= 0) {
+            const int q = log10Pow2(e2) - (e2 > 3);
+            const int j = -e2 + q + POW5_BITS + pow5bits(q) - 1;
+            e10 = q;
+            vr = mulShift(4 * m2, t.pow5Inv[q], j);
+            vp = mulShift(4 * m2 + 2, t.pow5Inv[q], j);
+            vm = mulShift(4 * m2 - 1 - mmShift, t.pow5Inv[q], j);
+            if (q <= 21) {
+                if (mv % 5 == 0) vrTrailingZeros = multipleOfPow5(mv, q);
+                else if (even) vmTrailingZeros = multipleOfPow5(mv - 1 - mmShift, q);
+                else vp -= multipleOfPow5(mv + 2, q);
+            }
+        } else {
+            const int q = log10Pow5(-e2) - (-e2 > 1);
+            const int i = -e2 - q;
+            const int j = q - (pow5bits(i) - POW5_BITS);
+            e10 = q + e2;
+            vr = mulShift(4 * m2, t.pow5[i], j);
+            vp = mulShift(4 * m2 + 2, t.pow5[i], j);
+            vm = mulShift(4 * m2 - 1 - mmShift, t.pow5[i], j);
+            if (q <= 1) {
+                vrTrailingZeros = true;
+                if (even) vmTrailingZeros = mmShift == 1;
+                else --vp;
+            } else if (q < 63) {
+                vrTrailingZeros = multipleOfPow2(mv, q);
+            }
+        }
+
+        // drop digits while the interval [vm, vp] still holds a shorter number
+        int removed = 0;
+        unsigned last = 0;
+        if (vmTrailingZeros || vrTrailingZeros) {
+            for (; vp / 10 > vm / 10; ++removed) {
+                vmTrailingZeros &= vm % 10 == 0;
+                vrTrailingZeros &= last == 0;
+                last = vr % 10;
+                vr /= 10, vp /= 10, vm /= 10;
+            }
+            if (vmTrailingZeros) {
+                for (; vm % 10 == 0; ++removed) {
+                    vrTrailingZeros &= last == 0;
+                    last = vr % 10;
+                    vr /= 10, vp /= 10, vm /= 10;
+                }
+            }
+            if (vrTrailingZeros && last == 5 && vr % 2 == 0) last = 4;
+            digits = vr + ((vr == vm && (!even || !vmTrailingZeros)) || last >= 5);
+        } else {
+            bool roundUp = false;
+            for (; vp / 10 > vm / 10; ++removed) {
+                roundUp = vr % 10 >= 5;
+                vr /= 10, vp /= 10, vm /= 10;
+            }
+            digits = vr + (vr == vm || roundUp);
+        }
+        exp = e10 + removed;
+    }
+
+    // Python's repr: positional when the decimal point falls within
+    // 16 digits of the first one and no more than 4 zeros after it,
+    // scientific otherwise.
+    inline size_t repr(char *out, double d) {
+        Parts x = split(d);
+        size_t n = 0;
+        if (x.neg && !(x.bexp == 0x7ff && x.frac)) out[n++] = '-';
+        if (x.bexp == 0x7ff) return special(out, n, x);
+        if (!x.bexp && !x.frac) return append(out, n, "0.0", 3);
+        u64 v;
+        int exp;
+        shortest(x, v, exp);
+        char tmp[24], *end = tmp + sizeof tmp, *p = digitsBack(end, v);
+        int len = end - p, point = exp + len;
+        if (point > -4 && point <= 16) {
+            if (point <= 0) {
+                n = append(out, n, "0.", 2);
+                memset(out + n, '0', -point), n += -point;
+                return append(out, n, p, len);
+            }
+            if (point >= len) {
+                n = append(out, n, p, len);
+                memset(out + n, '0', point - len), n += point - len;
+                return append(out, n, ".0", 2);
+            }
+            n = append(out, n, p, point);
+            out[n++] = '.';
+            return append(out, n, p + point, len - point);
+        }
+        out[n++] = *p;
+        if (len > 1) out[n++] = '.', n = append(out, n, p + 1, len - 1);
+        out[n++] = 'e';
+        int e = point - 1;
+        out[n++] = e < 0 ? '-' : '+';
+        if (e < 0) e = -e;
+        char *q = digitsBack(end, (u64) e);
+        if (e < 10) *--q = '0';
+        return append(out, n, q, end - q);
+    }
+
+}
+
+#endif
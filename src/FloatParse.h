@@ -0,0 +1,198 @@
+#ifndef PYTHON_INTERPRETER_FLOATPARSE_H
+#define PYTHON_INTERPRETER_FLOATPARSE_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Decimal text to double, correctly rounded: Clinger's exact fast path when
+// the digits and the power of ten are both exact doubles, else the
+// Eisel-Lemire algorithm (Lemire, "Number Parsing at a Gigabyte per
+// Second"), with strtod for the rare inputs it cannot decide.
+namespace floatparse {
+
+    typedef unsigned long long u64;
+    typedef unsigned __int128 u128;
+
+    static const int MIN_Q = -342, MAX_Q = 308;
+
+    // POW5[q - MIN_Q] is 5^q normalised to 128 bits: truncated for q >= 0,
+    // and a reciprocal rounded up for q < 0, following fast_float's
+    // recipe. Computed on first use: 5^k by repeated multiplication and
+    // floor(2^b / 5^k) by dividing a 2^N by 5 repeatedly.
+    struct Tables {
+        static const int LEN = 29, N = 1792;
+        u128 pow5[MAX_Q - MIN_Q + 1];
+
+        static int bitLength(const u64 *x) {
+            for (int i = LEN - 1; i >= 0; --i)
+                if (x[i]) return i * 64 + 64 - __builtin_clzll(x[i]);
+            return 0;
+        }
+        // floor(x / 2^k), truncated to 128 bits
+        static u128 window(const u64 *x, int k) {
+            u128 res = 0;
+            for (int b = 0; b < 3; ++b) {
+                int i = k / 64 + b, at = b * 64 - k % 64;
+                if (i >= LEN || at >= 128) break;
+                u128 w = x[i];
+                res |= at >= 0 ? w << at : w >> -at;
+            }
+            return res;
+        }
+        // y = floor(x / 2^k) + 1
+        static void shrInc(const u64 *x, int k, u64 *y) {
+            for (int i = 0; i < LEN; ++i) {
+                int j = i + k / 64;
+                u64 lo = j < LEN ? x[j] >> k % 64 : 0;
+                if (k % 64 && j + 1 < LEN) lo |= x[j + 1] << (64 - k % 64);
+                y[i] = lo;
+            }
+            for (int i = 0; i < LEN && !++y[i]; ++i) {}
+        }
+
+        Tables() {
+            u64 p[LEN] = {1}, x[LEN] = {}, c[LEN];
+            for (int q = 0; q <= MAX_Q; ++q) {
+                int len = bitLength(p);
+                pow5[q - MIN_Q] = len <= 128 ? window(p, 0) << (128 - len) : window(p, len - 128);
+                u64 carry = 0;
+                for (int i = 0; i < LEN; ++i) {
+                    u128 t = (u128) p[i] * 5 + carry;
+                    p[i] = (u64) t, carry = (u64) (t >> 64);
+                }
+            }
+            // p = 5^k and x = floor(2^N / 5^k) for k = 1, 2, ...
+            memset(p, 0, sizeof p);
+            p[0] = 1;
+            x[N / 64] = 1;
+            for (int k = 1; k <= -MIN_Q; ++k) {
+                u64 carry = 0, rem = 0;
+                for (int i = 0; i < LEN; ++i) {
+                    u128 t = (u128) p[i] * 5 + carry;
+                    p[i] = (u64) t, carry = (u64) (t >> 64);
+                }
+                for (int i = LEN - 1; i >= 0; --i) {
+                    u128 cur = (u128) rem << 64 | x[i];
+                    x[i] = (u64) (cur / 5), rem = (u64) (cur % 5);
+                }
+                int z = bitLength(p), b = k <= 27 ? z + 127 : 2 * z + 128;
+                shrInc(x, N - b, c);
+                int len = bitLength(c);
+                pow5[-k - MIN_Q] = len <= 128 ? window(c, 0) : window(c, len - 128);
+            }
+        }
+    };
+    inline const Tables &tables() {
+        static const Tables t;
+        return t;
+    }
+
+    inline double fromBits(u64 bits) {
+        double d;
+        memcpy(&d, &bits, sizeof d);
+        return d;
+    }
+
+    // w * 10^q for w != 0 as the bits of a double; false if undecided.
+    inline bool lemire(u64 w, int q, u64 &bits) {
+        if (q < MIN_Q) return bits = 0, true;
+        if (q > MAX_Q) return bits = 0x7ffull << 52, true;
+        int lz = __builtin_clzll(w);
+        w <<= lz;
+        u128 t = tables().pow5[q - MIN_Q], first = (u128) w * (u64) (t >> 64);
+        u64 hi = (u64) (first >> 64), lo = (u64) first;
+        // the top 55 bits are not settled yet: fold in the low half
+        if ((hi & 0x1ff) == 0x1ff) {
+            u64 carry = (u64) (((u128) w * (u64) t) >> 64);
+            lo += carry;
+            hi += lo < carry;
+            if (lo == ~0ull) return false;
+        }
+        int upper = (int) (hi >> 63), power2 = ((217706 * q) >> 16) + 63 + upper - lz + 1023;
+        u64 mant = hi >> (upper + 9);
+        if (power2 <= 0) {
+            if (-power2 + 1 >= 64) return bits = 0, true;
+            mant >>= -power2 + 1;
+            mant = (mant + (mant & 1)) >> 1;
+            return bits = mant, true;
+        }
+        // exactly halfway: round to even
+        if (lo <= 1 && q >= -4 && q <= 23 && (mant & 3) == 1 && mant << (upper + 9) == hi) mant &= ~1ull;
+        mant = (mant + (mant & 1)) >> 1;
+        if (mant >= 2ull << 52) mant = 1ull << 52, ++power2;
+        if (power2 >= 0x7ff) return bits = 0x7ffull << 52, true;
+        return bits = (mant & ((1ull << 52) - 1)) | (u64) power2 << 52, true;
+    }
+
+    inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    inline bool lowerIs(const char *p, const char *end, const char *word) {
+        size_t n = strlen(word);
+        if ((size_t) (end - p) != n) return false;
+        for (size_t i = 0; i < n; ++i)
+            if ((p[i] | 0x20) != word[i]) return false;
+        return true;
+    }
+
+    // [sign] (digits [. [digits]] | . digits) [(e|E) [sign] digits], or
+    // inf, infinity and nan in any case; the whole range must match.
+    inline bool parse(const char *first, const char *end, double &out) {
+        const char *p = first;
+        bool neg = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+        if (lowerIs(p, end, "inf") || lowerIs(p, end, "infinity")) return out = neg ? -HUGE_VAL : HUGE_VAL, true;
+        if (lowerIs(p, end, "nan")) return out = neg ? -NAN : NAN, true;
+
+        // the first 19 significant digits go to w, the rest only move q
+        u64 w = 0;
+        int digits = 0, q = 0;
+        bool any = false, truncated = false;
+        for (; p < end && *p == '0'; ++p) any = true;
+        for (; p < end && isDigit(*p); ++p, any = true) {
+            if (digits < 19) w = w * 10 + (*p - '0'), ++digits;
+            else ++q, truncated |= *p != '0';
+        }
+        if (p < end && *p == '.') {
+            ++p;
+            if (!digits)
+                for (; p < end && *p == '0'; ++p) --q, any = true;
+            for (; p < end && isDigit(*p); ++p, any = true) {
+                if (digits < 19) w = w * 10 + (*p - '0'), ++digits, --q;
+                else truncated |= *p != '0';
+            }
+        }
+        if (!any) return false;
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool eneg = p < end && *p == '-';
+            if (p < end && (*p == '-' || *p == '+')) ++p;
+            if (p == end || !isDigit(*p)) return false;
+            int e = 0;
+            for (; p < end && isDigit(*p); ++p)
+                if (e < 100000) e = e * 10 + (*p - '0');
+            q += eneg ? -e : e;
+        }
+        if (p != end) return false;
+
+        static const double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        double res;
+        u64 bits, bits1;
+        if (!w) res = 0;
+        else if (!truncated && w <= 1ull << 53 && q >= -22 && q <= 22)
+            res = q >= 0 ? (double) w * POW10[q] : (double) w / POW10[-q];
+        else if (lemire(w, q, bits) && (!truncated || (lemire(w + 1, q, bits1) && bits == bits1)))
+            res = fromBits(bits);
+        else {
+            out = strtod(std::string(first, end).c_str(), nullptr);
+            return true;
+        }
+        out = neg ? -res : res;
+        return true;
+    }
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PYTHON_INTERPRETER_GENERATOR_H
+#define PYTHON_INTERPRETER_GENERATOR_H
+
+#include <vector>
+#include "Python3Parser.h"
+#include "Scope.h"
+
+// A suspended generator frame. Instead of the native recursion of
+// visitSuite / visitWhile_stmt, the statements still to run are kept on an
+// explicit stack, so resuming is just popping back into the loop.
+class Generator : public Object {
+
+    public:
+        struct Frame {
+            Python3Parser::While_stmtContext *loop;
+            std::vector<Python3Parser::StmtContext *> stmt;
+            Python3Parser::Simple_stmtContext *simple;
+            size_t pc;
+            explicit Frame(Python3Parser::While_stmtContext *ctx) : loop(ctx), simple(nullptr), pc(0) {}
+            explicit Frame(Python3Parser::SuiteContext *ctx) : loop(nullptr), simple(ctx->simple_stmt()), pc(0) {
+                if (!simple) stmt = ctx->stmt();
+            }
+        };
+
+        Scope scope;
+        std::vector<Frame> frames;
+
+        Generator(const Scope &_scope, Python3Parser::SuiteContext *suite) : scope(_scope) {
+            frames.push_back(Frame(suite));
+        }
+        bool finished() const { return frames.empty(); }
+};
+
+inline BaseType::BaseType(Generator *_g) : t(5), big(false), p(_g) {}
+
+inline Generator *BaseType::gen() const {
+    return t == 5 ? static_cast<Generator *>(p) : nullptr;
+}
+
+#endif
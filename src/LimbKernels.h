@@ -0,0 +1,189 @@
+#ifndef PYTHON_INTERPRETER_LIMBKERNELS_H
+#define PYTHON_INTERPRETER_LIMBKERNELS_H
+
+#include <cstddef>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Carry chains behind int2048's add, subtract and multiply loops. On x86-64
+// long additions use AVX2 with carry lookahead, products of rows use
+// mulx with the two independent adcx / adox carry chains, and the plain
+// adc / sbb loops are the fallback; other targets get the scalar loops.
+namespace limbk {
+
+    typedef unsigned long long limb;
+    typedef unsigned __int128 wide;
+
+    // r[0, n) = a + b, returns the carry out. r may alias a or b.
+    inline limb addScalar(limb *r, const limb *a, const limb *b, size_t n) {
+        limb carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            wide s = (wide) a[i] + b[i] + carry;
+            r[i] = (limb) s;
+            carry = (limb) (s >> 64);
+        }
+        return carry;
+    }
+
+    // r[0, n) = a - b, returns the borrow out. r may alias a or b.
+    inline limb subScalar(limb *r, const limb *a, const limb *b, size_t n) {
+        limb borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            limb t = a[i] - b[i] - borrow;
+            borrow = a[i] < b[i] || a[i] - b[i] < borrow;
+            r[i] = t;
+        }
+        return borrow;
+    }
+
+    // r[0, n) += a * b, returns the limb carried out.
+    inline limb addMulScalar(limb *r, const limb *a, size_t n, limb b) {
+        limb carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            wide t = (wide) a[i] * b + r[i] + carry;
+            r[i] = (limb) t;
+            carry = (limb) (t >> 64);
+        }
+        return carry;
+    }
+
+#if defined(__x86_64__)
+
+    inline bool hasAVX2() {
+        static const bool res = __builtin_cpu_supports("avx2");
+        return res;
+    }
+    inline bool hasADX() {
+        static const bool res = __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("adx");
+        return res;
+    }
+
+    // Unrolled so that the flag chain is not broken by the loop counter.
+#define LIMBK_CHAIN(NAME, STEP)                                                                 \
+    inline limb NAME(limb *r, const limb *a, const limb *b, size_t n) {                         \
+        unsigned char c = 0;                                                                   \
+        size_t i = 0;                                                                          \
+        for (; i + 4 <= n; i += 4) {                                                           \
+            c = STEP(c, a[i], b[i], r + i), c = STEP(c, a[i + 1], b[i + 1], r + i + 1);        \
+            c = STEP(c, a[i + 2], b[i + 2], r + i + 2), c = STEP(c, a[i + 3], b[i + 3], r + i + 3); \
+        }                                                                                      \
+        for (; i < n; ++i) c = STEP(c, a[i], b[i], r + i);                                     \
+        return c;                                                                              \
+    }
+    LIMBK_CHAIN(addAdc, _addcarry_u64)
+    LIMBK_CHAIN(subSbb, _subborrow_u64)
+#undef LIMBK_CHAIN
+
+    // ONES[mask] has a 1 in lane k when bit k of mask is set.
+    alignas(32) static const long long ONES[16][4] = {
+        {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {1, 1, 0, 0},
+        {0, 0, 1, 0}, {1, 0, 1, 0}, {0, 1, 1, 0}, {1, 1, 1, 0},
+        {0, 0, 0, 1}, {1, 0, 0, 1}, {0, 1, 0, 1}, {1, 1, 0, 1},
+        {0, 0, 1, 1}, {1, 0, 1, 1}, {0, 1, 1, 1}, {1, 1, 1, 1},
+    };
+
+    // Four lanes at a time: lane k generates a carry when its sum wrapped
+    // and propagates one when it came out all ones (all zeros for a
+    // difference). With those as bit masks g and p, the carries into the
+    // lanes are the bits of ((g << 1) + p + c) ^ p, and bit 4 is the carry
+    // out of the block, so the chain costs one scalar add per four limbs.
+    // Unsigned compares are signed compares after flipping the top bit.
+#define LIMBK_LOOKAHEAD(NAME, OP, GEN, PROP, TAIL)                                              \
+    __attribute__((target("avx2"))) inline limb NAME(limb *r, const limb *a, const limb *b, size_t n) { \
+        const __m256i top = _mm256_set1_epi64x((long long) (1ull << 63));                      \
+        const __m256i prop = _mm256_set1_epi64x(PROP);                                         \
+        unsigned carry = 0;                                                                    \
+        size_t i = 0;                                                                          \
+        for (; i + 4 <= n; i += 4) {                                                           \
+            __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));                         \
+            __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));                         \
+            __m256i s = OP(x, y);                                                              \
+            unsigned g = _mm256_movemask_pd(_mm256_castsi256_pd(GEN));                         \
+            unsigned p = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(s, prop))); \
+            unsigned t = (g << 1) + p + carry;                                                 \
+            carry = t >> 4;                                                                    \
+            s = OP(s, _mm256_load_si256((const __m256i *) ONES[(t ^ p) & 15]));                \
+            _mm256_storeu_si256((__m256i *) (r + i), s);                                       \
+        }                                                                                      \
+        limb res = carry;                                                                      \
+        for (; i < n; ++i) res = TAIL(res, a[i], b[i], r + i);                                 \
+        return res;                                                                            \
+    }
+
+#define LIMBK_LT(u, v) _mm256_cmpgt_epi64(_mm256_xor_si256(v, top), _mm256_xor_si256(u, top))
+    // a sum wrapped when it is below an operand; a difference, when x < y
+    LIMBK_LOOKAHEAD(addAVX2, _mm256_add_epi64, LIMBK_LT(s, x), -1, _addcarry_u64)
+    LIMBK_LOOKAHEAD(subAVX2, _mm256_sub_epi64, LIMBK_LT(x, y), 0, _subborrow_u64)
+#undef LIMBK_LT
+#undef LIMBK_LOOKAHEAD
+
+    // Four products per iteration: mulx leaves the flags alone, adox adds
+    // each high half into the next low half and adcx adds the result into
+    // r, so the two carry chains run side by side. lea and jrcxz keep the
+    // loop from touching the flags either.
+    __attribute__((target("bmi2,adx"))) inline limb addMulADX(limb *r, const limb *a, size_t n, limb b) {
+        size_t head = n % 4, blocks = n / 4;
+        limb carry = addMulScalar(r, a, head, b);
+        if (!blocks) return carry;
+        const limb *x = a + head;
+        limb *y = r + head, l0, h0, l1, h1, zero = 0;
+        __asm__ volatile(
+            "xor %k[l0], %k[l0]\n\t"
+            "1:\n\t"
+            "mulx (%[x]), %[l0], %[h0]\n\t"
+            "adox %[c], %[l0]\n\t"
+            "adcx (%[y]), %[l0]\n\t"
+            "mov %[l0], (%[y])\n\t"
+            "mulx 8(%[x]), %[l1], %[h1]\n\t"
+            "adox %[h0], %[l1]\n\t"
+            "adcx 8(%[y]), %[l1]\n\t"
+            "mov %[l1], 8(%[y])\n\t"
+            "mulx 16(%[x]), %[l0], %[h0]\n\t"
+            "adox %[h1], %[l0]\n\t"
+            "adcx 16(%[y]), %[l0]\n\t"
+            "mov %[l0], 16(%[y])\n\t"
+            "mulx 24(%[x]), %[l1], %[c]\n\t"
+            "adox %[h0], %[l1]\n\t"
+            "adcx 24(%[y]), %[l1]\n\t"
+            "mov %[l1], 24(%[y])\n\t"
+            "lea 32(%[x]), %[x]\n\t"
+            "lea 32(%[y]), %[y]\n\t"
+            "lea -1(%[k]), %[k]\n\t"
+            "jrcxz 2f\n\t"
+            "jmp 1b\n\t"
+            "2:\n\t"
+            "adox %[z], %[c]\n\t"
+            "adcx %[z], %[c]\n\t"
+            : [c] "+&r"(carry), [l0] "=&r"(l0), [h0] "=&r"(h0), [l1] "=&r"(l1), [h1] "=&r"(h1),
+              [x] "+r"(x), [y] "+r"(y), [k] "+c"(blocks)
+            : "d"(b), [z] "r"(zero)
+            : "cc", "memory");
+        return carry;
+    }
+
+    // The unrolled adc chain already runs at about a limb per cycle; the
+    // vector loop only pulls ahead on long runs.
+    static const size_t AVX2_MIN = 32;
+
+    inline limb add(limb *r, const limb *a, const limb *b, size_t n) {
+        return n >= AVX2_MIN && hasAVX2() ? addAVX2(r, a, b, n) : addAdc(r, a, b, n);
+    }
+    inline limb sub(limb *r, const limb *a, const limb *b, size_t n) {
+        return n >= AVX2_MIN && hasAVX2() ? subAVX2(r, a, b, n) : subSbb(r, a, b, n);
+    }
+    inline limb addMul(limb *r, const limb *a, size_t n, limb b) {
+        return hasADX() ? addMulADX(r, a, n, b) : addMulScalar(r, a, n, b);
+    }
+    inline bool fastAddMul() { return hasADX(); }
+#else
+    inline limb add(limb *r, const limb *a, const limb *b, size_t n) { return addScalar(r, a, b, n); }
+    inline limb sub(limb *r, const limb *a, const limb *b, size_t n) { return subScalar(r, a, b, n); }
+    inline limb addMul(limb *r, const limb *a, size_t n, limb b) { return addMulScalar(r, a, n, b); }
+    inline bool fastAddMul() { return false; }
+#endif
+
+}
+
+#endif
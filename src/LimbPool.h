@@ -0,0 +1,98 @@
+#ifndef PYTHON_INTERPRETER_LIMBPOOL_H
+#define PYTHON_INTERPRETER_LIMBPOOL_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Heap blocks for LimbVector. Capacities up to 2^MAX_SHIFT limbs are
+// rounded to powers of two, and freed blocks of those size classes wait on
+// a free list of the freeing thread for the next request of the same
+// class instead of going back to malloc; each class keeps at most
+// KEEP_BYTES. Larger blocks go straight to malloc and free.
+namespace limbpool {
+
+    typedef unsigned long long limb;
+
+    static const int MIN_SHIFT = 3, MAX_SHIFT = 16;
+    static const size_t KEEP_BYTES = 1 << 20;
+
+    // Per thread.
+    struct Stats {
+        size_t allocs, hits;  // hits were served from a free list
+        size_t frees, cached; // cached blocks are on a free list now
+    };
+
+    struct Lists {
+        void *head[MAX_SHIFT + 1];
+        size_t count[MAX_SHIFT + 1];
+        Stats stats;
+        bool closed; // the thread is exiting, stop caching
+    };
+    // Plain data, so it stays usable while statics are destroyed.
+    inline Lists &lists() {
+        static thread_local Lists res;
+        return res;
+    }
+
+    // Returns the cached blocks to malloc when the thread exits.
+    struct Reaper {
+        ~Reaper() {
+            Lists &l = lists();
+            l.closed = true;
+            for (int s = MIN_SHIFT; s <= MAX_SHIFT; ++s) {
+                while (l.head[s]) {
+                    void *p = l.head[s];
+                    l.head[s] = *static_cast<void **>(p);
+                    free(p);
+                }
+                l.count[s] = 0;
+            }
+            l.stats.cached = 0;
+        }
+    };
+    inline void arm() {
+        static thread_local Reaper res;
+        (void) res;
+    }
+
+    inline int sizeClass(size_t n) { return n <= (size_t) 1 << MIN_SHIFT ? MIN_SHIFT : 64 - __builtin_clzll(n - 1); }
+
+    // A block of at least n limbs; n is raised to the capacity granted.
+    inline limb *allocate(size_t &n) {
+        Lists &l = lists();
+        ++l.stats.allocs;
+        int s = sizeClass(n);
+        if (s <= MAX_SHIFT) {
+            n = (size_t) 1 << s;
+            if (void *p = l.head[s]) {
+                l.head[s] = *static_cast<void **>(p);
+                --l.count[s], --l.stats.cached, ++l.stats.hits;
+                return static_cast<limb *>(p);
+            }
+            arm();
+        }
+        limb *res = static_cast<limb *>(malloc(n * sizeof(limb)));
+        if (!res) throw std::bad_alloc();
+        return res;
+    }
+    // p came from allocate with capacity n.
+    inline void release(limb *p, size_t n) {
+        Lists &l = lists();
+        ++l.stats.frees;
+        int s = sizeClass(n);
+        if (s <= MAX_SHIFT && !l.closed && (l.count[s] + 1) * n * sizeof(limb) <= KEEP_BYTES) {
+            arm();
+            *reinterpret_cast<void **>(p) = l.head[s];
+            l.head[s] = p;
+            ++l.count[s], ++l.stats.cached;
+            return;
+        }
+        free(p);
+    }
+
+    inline const Stats &stats() { return lists().stats; }
+
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef PYTHON_INTERPRETER_LIMBVECTOR_H
+#define PYTHON_INTERPRETER_LIMBVECTOR_H
+
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include "LimbPool.h"
+
+// The limb storage of int2048: the subset of std::vector it needs, with
+// room for INLINE limbs inside the object. Integers below 2^256 never touch
+// the heap, and moving a heap buffer just hands over the pointer. Heap
+// buffers come from limbpool.
+class LimbVector {
+
+    public:
+        typedef unsigned long long limb;
+        static const size_t INLINE = 4;
+
+    private:
+        limb *p;
+        size_t n, cap;
+        limb buf[INLINE];
+
+        bool local() const { return p == buf; }
+        void grow(size_t want) {
+            size_t c = cap * 2 > want ? cap * 2 : want;
+            limb *q = limbpool::allocate(c);
+            if (n) memcpy(q, p, n * sizeof(limb));
+            if (!local()) limbpool::release(p, cap);
+            p = q, cap = c;
+        }
+        void steal(LimbVector &rhs) {
+            n = rhs.n;
+            if (rhs.local()) {
+                p = buf, cap = INLINE;
+                if (n) memcpy(buf, rhs.buf, n * sizeof(limb));
+            } else {
+                p = rhs.p, cap = rhs.cap;
+                rhs.p = rhs.buf, rhs.cap = INLINE;
+            }
+            rhs.n = 0;
+        }
+
+    public:
+        LimbVector() : p(buf), n(0), cap(INLINE) {}
+        explicit LimbVector(size_t k, limb v = 0) : LimbVector() { assign(k, v); }
+        LimbVector(const limb *first, const limb *last) : LimbVector() {
+            reserve(last - first);
+            n = last - first;
+            if (n) memcpy(p, first, n * sizeof(limb));
+        }
+        LimbVector(const LimbVector &rhs) : LimbVector(rhs.begin(), rhs.end()) {}
+        LimbVector(LimbVector &&rhs) noexcept { steal(rhs); }
+        LimbVector &operator=(const LimbVector &rhs) {
+            if (this != &rhs) {
+                n = 0;
+                reserve(rhs.n);
+                n = rhs.n;
+                if (n) memcpy(p, rhs.p, n * sizeof(limb));
+            }
+            return *this;
+        }
+        LimbVector &operator=(LimbVector &&rhs) noexcept {
+            if (this != &rhs) {
+                if (!local()) limbpool::release(p, cap);
+                steal(rhs);
+            }
+            return *this;
+        }
+        ~LimbVector() {
+            if (!local()) limbpool::release(p, cap);
+        }
+
+        size_t size() const { return n; }
+        bool empty() const { return !n; }
+        size_t capacity() const { return cap; }
+        limb *data() { return p; }
+        const limb *data() const { return p; }
+        limb *begin() { return p; }
+        limb *end() { return p + n; }
+        const limb *begin() const { return p; }
+        const limb *end() const { return p + n; }
+        limb &operator[](size_t i) { return p[i]; }
+        const limb &operator[](size_t i) const { return p[i]; }
+        limb &back() { return p[n - 1]; }
+        const limb &back() const { return p[n - 1]; }
+
+        void reserve(size_t k) {
+            if (k > cap) grow(k);
+        }
+        void push_back(limb v) {
+            if (n == cap) grow(n + 1);
+            p[n++] = v;
+        }
+        void pop_back() { --n; }
+        void clear() { n = 0; }
+        // New limbs are zero; shrinking keeps the capacity.
+        void resize(size_t k) {
+            reserve(k);
+            if (k > n) memset(p + n, 0, (k - n) * sizeof(limb));
+            n = k;
+        }
+        void assign(size_t k, limb v) {
+            n = 0;
+            reserve(k);
+            for (size_t i = 0; i < k; ++i) p[i] = v;
+            n = k;
+        }
+        void insert(limb *pos, size_t k, limb v) {
+            size_t at = pos - p;
+            reserve(n + k);
+            memmove(p + at + k, p + at, (n - at) * sizeof(limb));
+            for (size_t i = 0; i < k; ++i) p[at + i] = v;
+            n += k;
+        }
+        void swap(LimbVector &rhs) {
+            LimbVector tmp(std::move(rhs));
+            rhs = std::move(*this);
+            *this = std::move(tmp);
+        }
+
+        friend bool operator==(const LimbVector &lhs, const LimbVector &rhs) {
+            return lhs.n == rhs.n && !memcmp(lhs.p, rhs.p, lhs.n * sizeof(limb));
+        }
+        friend bool operator!=(const LimbVector &lhs, const LimbVector &rhs) { return !(lhs == rhs); }
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef PYTHON_INTERPRETER_NTT_H
+#define PYTHON_INTERPRETER_NTT_H
+
+#include <cstdint>
+#include <vector>
+#include "Parallel.h"
+
+// Number theoretic transform convolution for the largest int2048 products.
+// The inputs are 32-bit pieces of the limbs, so a coefficient of the
+// product is below min(n, m) * 2^64; it is computed modulo three
+// NTT-friendly primes and rebuilt exactly with the Chinese remainder
+// theorem (Garner's form), which is exact while that bound stays below
+// P0 * P1 * P2 (about 7.9e25 > 2^86): always, up to MAX_LEN.
+// Long transforms spread their butterflies over the par:: pool; every
+// value is computed by the same modular operations whichever thread runs
+// it, so the result does not depend on the thread count.
+namespace ntt {
+
+    static const uint32_t P0 = 998244353, P1 = 469762049, P2 = 167772161;
+    // Every prime has 3 as a primitive root and supports lengths up to 2^23.
+    static const uint32_t G = 3;
+    static const size_t MAX_LEN = size_t(1) << 23;
+    // Loops shorter than this are not worth waking the pool for.
+    static const size_t GRAIN = size_t(1) << 14;
+
+    template <uint32_t P>
+    inline uint32_t power(uint64_t x, uint64_t e) {
+        uint64_t res = 1;
+        for (x %= P; e; e >>= 1, x = x * x % P)
+            if (e & 1) res = res * x % P;
+        return (uint32_t) res;
+    }
+
+    // w[k] = root^k for k < n / 2, where root has order n (or is the
+    // inverse of such a root).
+    template <uint32_t P>
+    std::vector<uint32_t> roots(size_t n, bool invert) {
+        uint64_t root = power<P>(G, (P - 1) / n);
+        if (invert) root = power<P>(root, P - 2);
+        std::vector<uint32_t> w(n / 2);
+        par::parallelFor(n / 2, GRAIN, [&](size_t lo, size_t hi) {
+            uint64_t x = power<P>(root, lo);
+            for (size_t k = lo; k < hi; ++k, x = x * root % P) w[k] = (uint32_t) x;
+        });
+        return w;
+    }
+
+    // In place, iterative radix-2 transform; the modulus is a template
+    // argument so that % compiles to multiplications. Stage len uses every
+    // (n / len)-th entry of the order-n root table.
+    template <uint32_t P>
+    void transform(std::vector<uint32_t> &a, bool invert) {
+        size_t n = a.size();
+        for (size_t i = 1, j = 0; i < n; ++i) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) std::swap(a[i], a[j]);
+        }
+        std::vector<uint32_t> w = roots<P>(n, invert);
+        for (size_t len = 2; len <= n; len <<= 1) {
+            size_t half = len / 2, stride = n / len;
+            // butterfly j pairs a[i + k] and a[i + k + half], i = j / half * len
+            par::parallelFor(n / 2, GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t j = lo; j < hi;) {
+                    size_t i = j / half * len, k = j % half, end = std::min(half, k + (hi - j));
+                    for (; k < end; ++k, ++j) {
+                        uint32_t u = a[i + k], v = (uint32_t) ((uint64_t) a[i + k + half] * w[k * stride] % P);
+                        a[i + k] = u + v >= P ? u + v - P : u + v;
+                        a[i + k + half] = u >= v ? u - v : u + P - v;
+                    }
+                }
+            });
+        }
+        if (invert) {
+            uint64_t inv = power<P>(n, P - 2);
+            par::parallelFor(n, GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) a[i] = (uint32_t) (a[i] * inv % P);
+            });
+        }
+    }
+
+    template <uint32_t P>
+    std::vector<uint32_t> reduce(const long long *a, size_t na, size_t n) {
+        std::vector<uint32_t> res(n);
+        par::parallelFor(na, GRAIN, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) res[i] = (uint32_t) (a[i] % P);
+        });
+        return res;
+    }
+
+    // Cyclic convolution of a and b modulo P with transform length n.
+    template <uint32_t P>
+    std::vector<uint32_t> convolve(const long long *a, size_t na, const long long *b, size_t nb, size_t n, bool square) {
+        std::vector<uint32_t> fa = reduce<P>(a, na, n), fb;
+        transform<P>(fa, false);
+        if (square) fb = fa;
+        else {
+            fb = reduce<P>(b, nb, n);
+            transform<P>(fb, false);
+        }
+        par::parallelFor(n, GRAIN, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) fa[i] = (uint32_t) ((uint64_t) fa[i] * fb[i] % P);
+        });
+        transform<P>(fa, true);
+        return fa;
+    }
+
+    // r[0, na + nb) = a * b in radix `radix`. na + nb - 1 must not exceed
+    // MAX_LEN.
+    inline void multiply(const long long *a, size_t na, const long long *b, size_t nb, long long *r,
+                         long long radix, bool square = false) {
+        size_t n = 1;
+        while (n < na + nb - 1) n <<= 1;
+        std::vector<uint32_t> r0 = convolve<P0>(a, na, b, nb, n, square);
+        std::vector<uint32_t> r1 = convolve<P1>(a, na, b, nb, n, square);
+        std::vector<uint32_t> r2 = convolve<P2>(a, na, b, nb, n, square);
+        const uint64_t inv01 = power<P1>(P0, P1 - 2);
+        const uint64_t inv012 = power<P2>((uint64_t) P0 * P1 % P2, P2 - 2);
+        const uint64_t p01 = (uint64_t) P0 * P1;
+        size_t len = na + nb - 1;
+        std::vector<unsigned __int128> x(len);
+        par::parallelFor(len, GRAIN, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                // x = v0 + v1 * P0 + v2 * P0 * P1 with v_k < P_k
+                uint64_t v0 = r0[i];
+                uint64_t v1 = (r1[i] + P1 - v0 % P1) * inv01 % P1;
+                uint64_t v2 = ((r2[i] + P2 - (v0 + v1 * P0) % P2) % P2) * inv012 % P2;
+                x[i] = v0 + (unsigned __int128) v1 * P0 + (unsigned __int128) v2 * p01;
+            }
+        });
+        unsigned __int128 carry = 0;
+        for (size_t i = 0; i < len; ++i) {
+            carry += x[i];
+            r[i] = (long long) (carry % radix);
+            carry /= radix;
+        }
+        r[len] = (long long) carry;
+    }
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef PYTHON_INTERPRETER_PARALLEL_H
+#define PYTHON_INTERPRETER_PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed pool of worker threads for the few loops that are worth
+// splitting (the transforms behind huge int2048 products). The pool is
+// created on first use with the size given by setThreads(); with one
+// thread, everything runs inline on the caller.
+namespace par {
+
+    class Pool {
+
+        private:
+            std::vector<std::thread> workers;
+            std::mutex lock;
+            std::condition_variable wake, idle;
+            const std::function<void(size_t)> *job;
+            size_t epoch, busy;
+            bool stop;
+
+            void loop(size_t id) {
+                size_t seen = 0;
+                for (;;) {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait(guard, [&] { return stop || epoch != seen; });
+                    if (stop) return;
+                    seen = epoch;
+                    const std::function<void(size_t)> *f = job;
+                    guard.unlock();
+                    (*f)(id);
+                    guard.lock();
+                    if (!--busy) idle.notify_one();
+                }
+            }
+
+        public:
+            explicit Pool(size_t n) : job(nullptr), epoch(0), busy(0), stop(false) {
+                for (size_t i = 1; i < n; ++i) workers.emplace_back(&Pool::loop, this, i);
+            }
+            ~Pool() {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    stop = true;
+                }
+                wake.notify_all();
+                for (auto &w : workers) w.join();
+            }
+            size_t size() const { return workers.size() + 1; }
+
+            // Calls f(0), ..., f(size() - 1) concurrently, f(0) on the
+            // calling thread, and returns once all of them have finished.
+            void run(const std::function<void(size_t)> &f) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    job = &f;
+                    busy = workers.size();
+                    ++epoch;
+                }
+                wake.notify_all();
+                f(0);
+                std::unique_lock<std::mutex> guard(lock);
+                idle.wait(guard, [&] { return !busy; });
+            }
+    };
+
+    static const size_t MAX_THREADS = 256;
+
+    inline size_t &threadCount() {
+        static size_t n = 1;
+        return n;
+    }
+    // n == 0 means one thread per hardware thread; at most MAX_THREADS.
+    // Must be called before the pool is first used.
+    inline void setThreads(size_t n) {
+        if (!n) n = std::max(1u, std::thread::hardware_concurrency());
+        threadCount() = std::min(n, MAX_THREADS);
+    }
+    inline Pool &pool() {
+        static Pool res(threadCount());
+        return res;
+    }
+    // Set while the current thread runs a parallelFor body.
+    inline bool &nested() {
+        static thread_local bool res = false;
+        return res;
+    }
+
+    // Runs f(lo, hi) over a partition of [0, n) into contiguous ranges, one
+    // per thread. Loops shorter than grain, and loops started from inside
+    // another parallelFor, stay on the calling thread.
+    template <class F>
+    void parallelFor(size_t n, size_t grain, const F &f) {
+        if (threadCount() == 1 || n < grain || nested()) {
+            f(size_t(0), n);
+            return;
+        }
+        Pool &p = pool();
+        size_t k = p.size();
+        p.run([&](size_t t) {
+            nested() = true;
+            f(n * t / k, n * (t + 1) / k);
+            nested() = false;
+        });
+    }
+
+}
+
+#endif
@@ -19,6 +19,11 @@ class Scope {
             varTable[varName] = varData;
         }    
 
+        BaseType *varFind(const std::string &varName) {
+            const auto &it = varTable.find(varName);
+            return it == varTable.end() ? nullptr : &it->second;
+        }
+
         std::pair<bool, BaseType> varQuery(const std::string& varName) const {
             const auto &it = varTable.find(varName);
             if (it == varTable.end()) return std::make_pair(false, BaseType());
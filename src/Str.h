@@ -0,0 +1,128 @@
+#ifndef PYTHON_INTERPRETER_STR_H
+#define PYTHON_INTERPRETER_STR_H
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "StrKernels.h"
+
+// An immutable string as (shared buffer, offset, length). Copies and slices
+// share the buffer; only short slices get a buffer of their own, so that a
+// tiny substring does not keep a huge parent alive.
+// Bytes already in a buffer are never changed, buffers only grow at the end.
+// Indices seen by scripts count UTF-8 code points; while a buffer holds only
+// ASCII they coincide with byte offsets.
+class Str {
+
+    private:
+        struct Buffer {
+            std::string text;
+            bool ascii;
+            explicit Buffer(std::string &&s) : text(std::move(s)) {
+                ascii = strk::isAscii(text.data(), text.size());
+            }
+            void append(const char *s, size_t n) {
+                if (ascii) ascii = strk::isAscii(s, n);
+                text.append(s, n);
+            }
+        };
+
+        static const size_t SMALL = 16;
+        std::shared_ptr<Buffer> buf;
+        size_t off, len;
+        mutable size_t cp; // cached code point count, npos if not known yet
+
+    public:
+        Str() : off(0), len(0), cp(0) {}
+        Str(const std::string &s) : Str(std::string(s)) {}
+        Str(std::string &&s) : off(0), len(s.size()), cp(strk::npos) {
+            buf = std::make_shared<Buffer>(std::move(s));
+        }
+        Str(const char *s) : Str(std::string(s)) {}
+
+        size_t size() const { return len; }
+        bool empty() const { return !len; }
+        const char *data() const { return buf ? buf->text.data() + off : ""; }
+        char operator[](size_t i) const { return data()[i]; }
+        std::string str() const { return std::string(data(), len); }
+        bool ascii() const { return !buf || buf->ascii; }
+
+        size_t length() const {
+            if (ascii()) return len;
+            if (cp == strk::npos) cp = strk::utf8Length(data(), len);
+            return cp;
+        }
+        // Byte offset of code point k (k <= length()).
+        size_t offset(size_t k) const {
+            if (ascii()) return k;
+            const char *s = data();
+            size_t i = 0;
+            for (; i < len; ++i)
+                if (strk::isLead(s[i]) && !k--) break;
+            return i;
+        }
+        // Code point index of byte offset i.
+        size_t index(size_t i) const {
+            return ascii() ? i : strk::utf8Length(data(), i);
+        }
+
+        Str substr(size_t pos, size_t n) const {
+            if (pos >= len) return Str();
+            if (n > len - pos) n = len - pos;
+            if (n <= SMALL || len <= SMALL) return Str(std::string(data() + pos, n));
+            Str res(*this);
+            res.off += pos;
+            res.len = n;
+            res.cp = strk::npos;
+            return res;
+        }
+
+        // If lhs reaches the end of its buffer, rhs is appended to that buffer
+        // and the result is a longer view on it. Views that already existed
+        // keep their length and do not see the new bytes, and the buffer
+        // grows geometrically, so `s = s + t` in a loop is amortised O(|t|).
+        friend Str operator+(const Str &lhs, const Str &rhs) {
+            if (!rhs.len) return lhs;
+            if (!lhs.len) return rhs;
+            if (lhs.off + lhs.len != lhs.buf->text.size()) {
+                std::string res;
+                res.reserve(lhs.len + rhs.len);
+                res.append(lhs.data(), lhs.len).append(rhs.data(), rhs.len);
+                return Str(std::move(res));
+            }
+            if (rhs.buf == lhs.buf) {
+                std::string tmp = rhs.str();
+                lhs.buf->append(tmp.data(), tmp.size());
+            } else lhs.buf->append(rhs.data(), rhs.len);
+            Str res(lhs);
+            res.len += rhs.len;
+            res.cp = lhs.cp == strk::npos || rhs.cp == strk::npos ? strk::npos : lhs.cp + rhs.cp;
+            return res;
+        }
+
+        // In place: when no other value shares the buffer, whatever lies past
+        // this view is dead and can be overwritten.
+        Str &operator+=(const Str &rhs) {
+            if (len && rhs.buf != buf && buf.use_count() == 1) buf->text.resize(off + len);
+            return *this = *this + rhs;
+        }
+
+        static int compare(const Str &lhs, const Str &rhs) {
+            if (lhs.buf == rhs.buf && lhs.off == rhs.off)
+                return lhs.len < rhs.len ? -1 : lhs.len > rhs.len;
+            int res = memcmp(lhs.data(), rhs.data(), std::min(lhs.len, rhs.len));
+            if (res) return res;
+            return lhs.len < rhs.len ? -1 : lhs.len > rhs.len;
+        }
+        friend bool operator==(const Str &lhs, const Str &rhs) {
+            return lhs.len == rhs.len && !compare(lhs, rhs);
+        }
+        friend bool operator<(const Str &lhs, const Str &rhs) { return compare(lhs, rhs) < 0; }
+
+        friend std::ostream &operator<<(std::ostream &lhs, const Str &rhs) {
+            return lhs.write(rhs.data(), rhs.len);
+        }
+};
+
+#endif
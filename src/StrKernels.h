@@ -0,0 +1,123 @@
+#ifndef PYTHON_INTERPRETER_STRKERNELS_H
+#define PYTHON_INTERPRETER_STRKERNELS_H
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Byte search / counting kernels behind the string builtins. On x86-64 an
+// AVX2 version is picked at runtime and SSE2 (always present) is the
+// fallback; other targets get the scalar loops.
+namespace strk {
+
+    static const size_t npos = (size_t) -1;
+
+    // Non-continuation bytes are those that are not 10xxxxxx, i.e. greater
+    // than (signed char) 0xBF.
+    inline bool isLead(char ch) { return (signed char) ch > (signed char) 0xBF; }
+
+    inline size_t countByteScalar(const char *s, size_t n, char c) {
+        size_t res = 0;
+        for (size_t i = 0; i < n; ++i) res += s[i] == c;
+        return res;
+    }
+
+    inline size_t utf8LengthScalar(const char *s, size_t n) {
+        size_t res = 0;
+        for (size_t i = 0; i < n; ++i) res += isLead(s[i]);
+        return res;
+    }
+
+    inline bool isAsciiScalar(const char *s, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            if (s[i] & 0x80) return false;
+        return true;
+    }
+
+    inline size_t findScalar(const char *s, size_t n, const char *t, size_t m, size_t from) {
+        for (size_t i = from; i + m <= n; ++i) {
+            const char *p = (const char *) memchr(s + i, t[0], n - m + 1 - i);
+            if (!p) return npos;
+            i = p - s;
+            if (!memcmp(p + 1, t + 1, m - 1)) return i;
+        }
+        return npos;
+    }
+
+#if defined(__x86_64__)
+
+    inline bool hasAVX2() {
+        static const bool res = __builtin_cpu_supports("avx2");
+        return res;
+    }
+
+    // A block of W bytes matches where both the first and the last needle
+    // byte line up; only those candidates are compared in full.
+#define STRK_KERNELS(W, TARGET, VEC, LOAD, SET1, CMPEQ, CMPGT, AND, OR, MOVEMASK)           \
+    __attribute__((target(TARGET))) inline size_t countByte##W(const char *s, size_t n, char c) { \
+        const VEC v = SET1(c);                                                               \
+        size_t res = 0, i = 0;                                                               \
+        for (; i + W <= n; i += W)                                                           \
+            res += __builtin_popcount(MOVEMASK(CMPEQ(LOAD((const VEC *) (s + i)), v)));      \
+        return res + countByteScalar(s + i, n - i, c);                                       \
+    }                                                                                        \
+    __attribute__((target(TARGET))) inline size_t utf8Length##W(const char *s, size_t n) {  \
+        const VEC v = SET1((char) 0xBF);                                                     \
+        size_t res = 0, i = 0;                                                               \
+        for (; i + W <= n; i += W)                                                           \
+            res += __builtin_popcount(MOVEMASK(CMPGT(LOAD((const VEC *) (s + i)), v)));      \
+        return res + utf8LengthScalar(s + i, n - i);                                         \
+    }                                                                                        \
+    __attribute__((target(TARGET))) inline bool isAscii##W(const char *s, size_t n) {       \
+        VEC acc = SET1(0);                                                                   \
+        size_t i = 0;                                                                        \
+        for (; i + W <= n; i += W) acc = OR(acc, LOAD((const VEC *) (s + i)));               \
+        return !MOVEMASK(acc) && isAsciiScalar(s + i, n - i);                                \
+    }                                                                                        \
+    __attribute__((target(TARGET))) inline size_t find##W(const char *s, size_t n,          \
+                                                          const char *t, size_t m, size_t from) { \
+        const VEC first = SET1(t[0]), last = SET1(t[m - 1]);                                 \
+        size_t i = from;                                                                     \
+        for (; i + m - 1 + W <= n; i += W) {                                                 \
+            VEC x = CMPEQ(first, LOAD((const VEC *) (s + i)));                               \
+            VEC y = CMPEQ(last, LOAD((const VEC *) (s + i + m - 1)));                        \
+            unsigned mask = MOVEMASK(AND(x, y));                                             \
+            while (mask) {                                                                   \
+                size_t k = i + __builtin_ctz(mask);                                          \
+                if (m < 3 || !memcmp(s + k + 1, t + 1, m - 2)) return k;                     \
+                mask &= mask - 1;                                                            \
+            }                                                                                \
+        }                                                                                    \
+        return findScalar(s, n, t, m, i);                                                    \
+    }
+
+    STRK_KERNELS(32, "avx2", __m256i, _mm256_loadu_si256, _mm256_set1_epi8, _mm256_cmpeq_epi8,
+                 _mm256_cmpgt_epi8, _mm256_and_si256, _mm256_or_si256, _mm256_movemask_epi8)
+    STRK_KERNELS(16, "sse2", __m128i, _mm_loadu_si128, _mm_set1_epi8, _mm_cmpeq_epi8,
+                 _mm_cmpgt_epi8, _mm_and_si128, _mm_or_si128, _mm_movemask_epi8)
+#undef STRK_KERNELS
+
+#define STRK_DISPATCH(NAME, ...) (hasAVX2() ? NAME##32(__VA_ARGS__) : NAME##16(__VA_ARGS__))
+#else
+#define STRK_DISPATCH(NAME, ...) NAME##Scalar(__VA_ARGS__)
+#endif
+
+    inline size_t countByte(const char *s, size_t n, char c) { return STRK_DISPATCH(countByte, s, n, c); }
+    inline size_t utf8Length(const char *s, size_t n) { return STRK_DISPATCH(utf8Length, s, n); }
+    inline bool isAscii(const char *s, size_t n) { return STRK_DISPATCH(isAscii, s, n); }
+
+    // Byte offset of the first occurrence of t[0, m) in s[from, n), or npos.
+    inline size_t find(const char *s, size_t n, const char *t, size_t m, size_t from = 0) {
+        if (!m) return from <= n ? from : npos;
+        if (from > n || m > n - from) return npos;
+        return STRK_DISPATCH(find, s, n, t, m, from);
+    }
+
+#undef STRK_DISPATCH
+
+}
+
+#endif
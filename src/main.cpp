@@ -1,12 +1,42 @@
 #include <iostream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include "antlr4-runtime.h"
 #include "Python3Lexer.h"
 #include "Python3Parser.h"
 #include "Evalvisitor.h"
 using namespace antlr4;
+static void printLimbStats() {
+    const limbpool::Stats &s = limbpool::stats();
+    fprintf(stderr, "limb pool: %zu allocations, %zu from free lists, %zu frees\n", s.allocs, s.hits, s.frees);
+}
+// A thread count for --bigint-threads: a decimal number from 0 to
+// par::MAX_THREADS. Anything else ends the program with a usage error.
+static size_t parseThreads(const char *s) {
+    char *end;
+    errno = 0;
+    long n = strtol(s, &end, 10);
+    if (end == s || *end || errno || n < 0 || n > (long) par::MAX_THREADS) {
+        fprintf(stderr, "usage: --bigint-threads N, N an integer from 0 (all cores) to %zu; got '%s'\n",
+                par::MAX_THREADS, s);
+        exit(2);
+    }
+    return n;
+}
 //todo: regenerating files in directory named "generated" is dangerous.
 //       if you really need to regenerate,please ask TA for help.
 int main(int argc, const char* argv[]){
+    // --bigint-threads N (or =N): threads for huge integer products, 0 = all cores
+    // --limb-stats: print the main thread's limb pool counters at exit
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--bigint-threads"))
+            par::setThreads(parseThreads(i + 1 < argc ? argv[++i] : ""));
+        else if (!strncmp(argv[i], "--bigint-threads=", 17))
+            par::setThreads(parseThreads(argv[i] + 17));
+        else if (!strcmp(argv[i], "--limb-stats"))
+            atexit(printLimbStats);
+    }
     //todo:please don't modify the code below the construction of ifs if you want to use visitor mode
     ANTLRInputStream input(std::cin);
     Python3Lexer lexer(&input);
@@ -15,6 +45,16 @@ int main(int argc, const char* argv[]){
     Python3Parser parser(&tokens);
     tree::ParseTree* tree=parser.file_input();
     EvalVisitor visitor;
-    visitor.visit(tree);
+    try {
+        visitor.visit(tree);
+    } catch (Exception &e) {
+        std::cout.flush();
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (std::bad_alloc &) {
+        std::cout.flush();
+        std::cerr << "MemoryError" << std::endl;
+        return 1;
+    }
     return 0;
 }
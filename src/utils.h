@@ -3,6 +3,7 @@
 
 #include <string>
 #include "BigInteger.h"
+#include "FloatParse.h"
 
 static bool validateVarName(const std::string& str) {
     for (const auto& ch : str) {
@@ -14,6 +15,32 @@ static bool validateVarName(const std::string& str) {
 }
 
 static void getAugassign(BaseType &lhs, const BaseType &rhs, const int &opt) {
+    // Update the slot in place where the result keeps the type of lhs.
+    if (lhs.t == 2 && lhs.big && (rhs.t == 1 || rhs.t == 2) && opt <= 3) {
+        int2048 &l = lhs.bigint(), tmp;
+        const int2048 &r = rhs.intRef(tmp);
+        if (opt == 1) l += r;
+        if (opt == 2) l -= r;
+        if (opt == 3) l *= r;
+        lhs.shrink();
+        return;
+    }
+    long long y;
+    if (lhs.t == 2 && lhs.big && opt == 5 && rhs.small(y) && y != 0) {
+        lhs.bigint().divmodSmall(y);
+        lhs.shrink();
+        return;
+    }
+    if (lhs.t == 3 && rhs.t >= 1 && rhs.t <= 3) {
+        if (opt == 1) { lhs.d += (double) rhs; return; }
+        if (opt == 2) { lhs.d -= (double) rhs; return; }
+        if (opt == 3) { lhs.d *= (double) rhs; return; }
+        if (opt == 4) { lhs.d /= (double) rhs; return; }
+    }
+    if (lhs.t == 4 && rhs.t == 4 && opt == 1) {
+        lhs.str() += rhs.text();
+        return;
+    }
     if (opt == 1) lhs = lhs + rhs;
     if (opt == 2) lhs = lhs - rhs;
     if (opt == 3) lhs = mul(lhs, rhs);
@@ -33,23 +60,33 @@ static bool mycmp(const BaseType &lhs, const BaseType &rhs, const int &opt) {
     // '<'|'>'|'=='|'>='|'<=' | '!='
 }
 
-static std::pair<bool, double> stringToDouble(const string &number) { // TODO: Utils.h
-    int idx = -1, sz = number.size();
-    for (int i = 0; i < sz; ++i)
-        if (number[i] == '.') idx = i;
-    if (idx == -1) return std::make_pair(false, 0);
-    double res = 0;
-    for (int i = (number[0] == '-'); i < idx; ++i)
-        res = res * 10 + number[i] - '0';
+// Normalises a Python index / slice bound against a sequence of length len.
+static long long sliceIndex(const BaseType &x, long long len, long long dflt) {
+    if (!x.t) return dflt;
+    int2048 i = (int2048) x;
+    if (i < int2048(-len)) return 0;
+    if (i > int2048(len)) return len;
+    long long k = (int) i;
+    return k < 0 ? k + len : k;
+}
 
-    double tmp = 0.1;
-    for (int i = idx + 1; i < sz; ++i) {
-        res += tmp * (number[i] - '0');
-        tmp /= 10.0;
+// Decimal literals short enough to always fit in a long long.
+static bool stringToLL(const string &number, long long &x) {
+    if (number.size() > 18) return false;
+    x = 0;
+    for (auto ch : number) {
+        if (ch < '0' || ch > '9') return false;
+        x = x * 10 + ch - '0';
     }
+    return true;
+}
 
-    if (number[0] == '-') res = -res;
-    return std::make_pair(true, res);
+// Float literals, i.e. with a point or an exponent, correctly rounded.
+static std::pair<bool, double> stringToDouble(const string &number) {
+    double res = 0;
+    if (number.find_first_of(".eE") == string::npos) return std::make_pair(false, res);
+    bool ok = floatparse::parse(number.data(), number.data() + number.size(), res);
+    return std::make_pair(ok, res);
 }
 
 
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include <new>
+
 #include "antlr4-common.h"
 
 #ifdef _MSC_VER
@@ -19,50 +22,60 @@ namespace antlrcpp {
 template<class T>
   using StorageType = typename std::decay<T>::type;
 
+// Values of up to BUFFER_SIZE bytes that can be moved without throwing are
+// kept inside the Any; anything else goes to the heap. Every stored type
+// has one table of operations, and its address doubles as the type tag, so
+// is() and as() compare a pointer instead of going through dynamic_cast.
 struct ANTLR4CPP_PUBLIC Any
 {
-  bool isNull() const { return _ptr == nullptr; }
-  bool isNotNull() const { return _ptr != nullptr; }
+  static const size_t BUFFER_SIZE = 48;
+
+  bool isNull() const { return _table == nullptr; }
+  bool isNotNull() const { return _table != nullptr; }
 
-  Any() : _ptr(nullptr) {
+  Any() : _table(nullptr) {
   }
 
-  Any(Any& that) : _ptr(that.clone()) {
+  Any(Any& that) : _table(nullptr) {
+    copyFrom(that);
   }
 
-  Any(Any&& that) : _ptr(that._ptr) {
-    that._ptr = nullptr;
+  Any(Any&& that) : _table(nullptr) {
+    moveFrom(that);
   }
 
-  Any(const Any& that) : _ptr(that.clone()) {
+  Any(const Any& that) : _table(nullptr) {
+    copyFrom(that);
   }
 
-  Any(const Any&& that) : _ptr(that.clone()) {
+  Any(const Any&& that) : _table(nullptr) {
+    copyFrom(that);
   }
 
   template<typename U>
-  Any(U&& value) : _ptr(new Derived<StorageType<U>>(std::forward<U>(value))) {
+  Any(U&& value) : _table(&Ops<StorageType<U>>::table) {
+    Ops<StorageType<U>>::create(_storage, std::forward<U>(value));
   }
 
   template<class U>
   bool is() const {
-    auto derived = getDerived<U>(false);
-
-    return derived != nullptr;
+    return _table == &Ops<StorageType<U>>::table;
   }
 
   template<class U>
   StorageType<U>& as() {
-    auto derived = getDerived<U>(true);
+    if (!is<U>())
+      throw std::bad_cast();
 
-    return derived->value;
+    return *Ops<StorageType<U>>::get(_storage);
   }
 
   template<class U>
   const StorageType<U>& as() const {
-    auto derived = getDerived<U>(true);
+    if (!is<U>())
+      throw std::bad_cast();
 
-    return derived->value;
+    return *Ops<StorageType<U>>::get(const_cast<Storage&>(_storage));
   }
 
   template<class U>
@@ -76,23 +89,22 @@ struct ANTLR4CPP_PUBLIC Any
   }
 
   Any& operator = (const Any& a) {
-    if (_ptr == a._ptr)
+    if (this == &a)
       return *this;
 
-    auto old_ptr = _ptr;
-    _ptr = a.clone();
-
-    if (old_ptr)
-      delete old_ptr;
+    Any copy(a);
+    reset();
+    moveFrom(copy);
 
     return *this;
   }
 
   Any& operator = (Any&& a) {
-    if (_ptr == a._ptr)
+    if (this == &a)
       return *this;
 
-    std::swap(_ptr, a._ptr);
+    reset();
+    moveFrom(a);
 
     return *this;
   }
@@ -100,66 +112,123 @@ struct ANTLR4CPP_PUBLIC Any
   virtual ~Any();
 
   virtual bool equals(Any other) const {
-    return _ptr == other._ptr;
+    return isNull() && other.isNull();
   }
 
 private:
-  struct Base {
-    virtual ~Base() {};
-    virtual Base* clone() const = 0;
+  union Storage {
+    void *ptr;
+    typename std::aligned_storage<BUFFER_SIZE, alignof(std::max_align_t)>::type buffer;
+  };
+
+  struct Table {
+    void (*destroy)(Storage &);
+    void (*copy)(const Storage &, Storage &); // nullptr if the type cannot be copied
+    void (*move)(Storage &, Storage &);       // leaves the source destroyed
   };
 
   template<typename T>
-  struct Derived : Base
-  {
-    template<typename U> Derived(U&& value_) : value(std::forward<U>(value_)) {
-    }
+  static constexpr bool fitsInline() {
+    return sizeof(T) <= BUFFER_SIZE && alignof(T) <= alignof(Storage) && std::is_nothrow_move_constructible<T>::value;
+  }
 
-    T value;
+  template<typename T, bool Inline = fitsInline<T>()>
+  struct Ops;
 
-    Base* clone() const {
-      return clone<>();
-    }
+  template<typename T>
+  struct Ops<T, true> {
+    static const Table table;
 
-  private:
-    template<int N = 0, typename std::enable_if<N == N && std::is_copy_constructible<T>::value, int>::type = 0>
-    Base* clone() const {
-      return new Derived<T>(value);
+    static T* get(Storage &s) {
+      return reinterpret_cast<T*>(&s.buffer);
     }
-
-    template<int N = 0, typename std::enable_if<N == N && !std::is_copy_constructible<T>::value, int>::type = 0>
-    Base* clone() const {
-      return nullptr;
+    template<typename U>
+    static void create(Storage &s, U&& value) {
+      new (&s.buffer) T(std::forward<U>(value));
+    }
+    static void destroy(Storage &s) {
+      get(s)->~T();
+    }
+    static void copy(const Storage &from, Storage &to) {
+      create(to, *get(const_cast<Storage&>(from)));
     }
+    static void move(Storage &from, Storage &to) {
+      create(to, std::move(*get(from)));
+      destroy(from);
+    }
+  };
 
+  template<typename T>
+  struct Ops<T, false> {
+    static const Table table;
+
+    static T* get(Storage &s) {
+      return static_cast<T*>(s.ptr);
+    }
+    template<typename U>
+    static void create(Storage &s, U&& value) {
+      s.ptr = new T(std::forward<U>(value));
+    }
+    static void destroy(Storage &s) {
+      delete get(s);
+    }
+    static void copy(const Storage &from, Storage &to) {
+      to.ptr = new T(*static_cast<const T*>(from.ptr));
+    }
+    static void move(Storage &from, Storage &to) {
+      to.ptr = from.ptr;
+    }
   };
 
-  Base* clone() const
-  {
-    if (_ptr)
-      return _ptr->clone();
-    else
-      return nullptr;
+  template<typename T>
+  static constexpr void (*copier(std::true_type))(const Storage &, Storage &) {
+    return &Ops<T>::copy;
   }
 
-  template<class U>
-  Derived<StorageType<U>>* getDerived(bool checkCast) const {
-    typedef StorageType<U> T;
+  template<typename T>
+  static constexpr void (*copier(std::false_type))(const Storage &, Storage &) {
+    return nullptr;
+  }
 
-    auto derived = dynamic_cast<Derived<T>*>(_ptr);
+  void copyFrom(const Any& that) {
+    if (that._table && that._table->copy) {
+      that._table->copy(that._storage, _storage);
+      _table = that._table;
+    }
+  }
 
-    if (checkCast && !derived)
-      throw std::bad_cast();
+  void moveFrom(Any& that) {
+    if (that._table) {
+      that._table->move(that._storage, _storage);
+      _table = that._table;
+      that._table = nullptr;
+    }
+  }
 
-    return derived;
+  void reset() {
+    if (_table) {
+      _table->destroy(_storage);
+      _table = nullptr;
+    }
   }
 
-  Base *_ptr;
+  const Table *_table;
+  Storage _storage;
 
 };
 
+  template<typename T>
+  const Any::Table Any::Ops<T, true>::table = {
+    &Ops<T, true>::destroy, Any::copier<T>(std::is_copy_constructible<T>()), &Ops<T, true>::move
+  };
+
+  template<typename T>
+  const Any::Table Any::Ops<T, false>::table = {
+    &Ops<T, false>::destroy, Any::copier<T>(std::is_copy_constructible<T>()), &Ops<T, false>::move
+  };
+
   template<> inline
-  Any::Any(std::nullptr_t&& ) : _ptr(nullptr) {
+  Any::Any(std::nullptr_t&& ) : _table(nullptr) {
   }
 
 